@@ -0,0 +1,52 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _ASYNC_FLOW_H_
+#define _ASYNC_FLOW_H_
+
+//=====[Libraries]=============================================================
+
+//=====[Declaration of public defines]=========================================
+
+// Stackless coroutines in the protothread style: a flow is a function that
+// returns ASYNC_FLOW_WAITING when it has to wait and is called again later
+// to carry on from that point. Only the resume point is kept between calls,
+// so anything a flow needs after a wait must live in a frame owned by the
+// caller, never in local variables. Waits must not be placed inside a
+// switch statement of the flow itself.
+
+#define ASYNC_FLOW_BEGIN( flow )                                             \
+    switch ( (flow)->resumePoint ) {                                         \
+        case 0:
+
+// Always gives control back at least once, then waits for condition
+#define ASYNC_FLOW_YIELD_UNTIL( flow, condition )                            \
+    do {                                                                     \
+        (flow)->resumePoint = __LINE__;                                      \
+        return ASYNC_FLOW_WAITING;                                           \
+        case __LINE__:                                                       \
+        if ( !(condition) ) {                                                \
+            return ASYNC_FLOW_WAITING;                                       \
+        }                                                                    \
+    } while ( 0 )
+
+#define ASYNC_FLOW_END( flow )                                               \
+    }                                                                        \
+    (flow)->resumePoint = 0;                                                 \
+    return ASYNC_FLOW_DONE
+
+//=====[Declaration of public data types]======================================
+
+typedef enum {
+    ASYNC_FLOW_WAITING,
+    ASYNC_FLOW_DONE,
+} asyncFlowStatus_t;
+
+typedef struct asyncFlow {
+    int resumePoint;
+} asyncFlow_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+//=====[#include guards - end]=================================================
+
+#endif // _ASYNC_FLOW_H_
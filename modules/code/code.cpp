@@ -11,6 +11,9 @@
 #include "temperature_sensor.h"
 #include "gas_sensor.h"
 #include "matrix_keypad.h"
+#include "user_codes.h"
+#include "event_log.h"
+#include "metrics.h"
 
 //=====[Declaration of private defines]========================================
 
@@ -26,7 +29,7 @@ extern char codeSequenceFromPcSerialCom[CODE_NUMBER_OF_KEYS];
 //=====[Declaration and initialization of private global variables]============
 
 static int numberOfIncorrectCodes = 0;
-static char codeSequence[CODE_NUMBER_OF_KEYS] = { '1', '8', '0', '5' };
+static char codeSequence[CODE_NUMBER_OF_KEYS] = { '1', '8', '0', '5', '2', '4' };
 
 //=====[Declarations (prototypes) of private functions]========================
 
@@ -43,6 +46,18 @@ void codeWrite( char* newCodeSequence )
     }
 }
 
+// A valid code is CODE_NUMBER_OF_KEYS digits, as typed on the keypad
+bool codeSequenceCheck( const char* codeSequenceToCheck )
+{
+    int i;
+    for (i = 0; i < CODE_NUMBER_OF_KEYS; i++) {
+        if ( codeSequenceToCheck[i] < '0' || codeSequenceToCheck[i] > '9' ) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool codeMatchFrom( codeOrigin_t codeOrigin )
 {
     bool codeIsCorrect = false;
@@ -56,6 +71,7 @@ bool codeMatchFrom( codeOrigin_t codeOrigin )
                 } else {
                     incorrectCodeStateWrite(ON);
                     numberOfIncorrectCodes++;
+                    metricsCounterIncrement( METRICS_COUNTER_INCORRECT_CODES );
                 }
             }
 
@@ -67,11 +83,12 @@ bool codeMatchFrom( codeOrigin_t codeOrigin )
                 pcSerialComCodeCompleteWrite(false);
                 if ( codeIsCorrect ) {
                     codeDeactivate();
-                    pcSerialComStringWrite( "\r\nThe code is correct\r\n\r\n" );
+                    pcSerialComCodeReplyWrite( "\r\nThe code is correct\r\n\r\n" );
                 } else {
                     incorrectCodeStateWrite(ON);
                     numberOfIncorrectCodes++;
-                    pcSerialComStringWrite( "\r\nThe code is incorrect\r\n\r\n" );
+                    metricsCounterIncrement( METRICS_COUNTER_INCORRECT_CODES );
+                    pcSerialComCodeReplyWrite( "\r\nThe code is incorrect\r\n\r\n" );
                 }
             }
 
@@ -81,22 +98,45 @@ bool codeMatchFrom( codeOrigin_t codeOrigin )
     }
 
     if ( numberOfIncorrectCodes >= 5 ) {
+        if ( !systemBlockedStateRead() ) {
+            metricsCounterIncrement( METRICS_COUNTER_SYSTEM_BLOCKS );
+        }
         systemBlockedStateWrite(ON);
     }
 
     return codeIsCorrect;
 }
 
+// True when the code is the master code. Not a code entry: it is neither
+// logged nor counted as an attempt.
+bool codeMasterCheck( const char* codeToCompare )
+{
+    return userCodesEqual( codeSequence, codeToCompare );
+}
+
+// Clears the incorrect code and blocked states as a correct code would
+void codeLockoutReset()
+{
+    codeDeactivate();
+}
+
 //=====[Implementations of private functions]==================================
 
+// codeSequence is the master code, user 0; the other users are in the
+// user code table. The table lookup stops at the first match, so the time
+// taken does depend on the code; guessing is bounded by the lockout after
+// five incorrect codes instead. A match is logged with the user's id.
 static bool codeMatch( char* codeToCompare )
 {
-    int i;
-    for (i = 0; i < CODE_NUMBER_OF_KEYS; i++) {
-        if ( codeSequence[i] != codeToCompare[i] ) {
-            return false;
-        }
+    int userId = userCodesFind( codeToCompare );
+
+    if ( codeMasterCheck( codeToCompare ) ) {
+        userId = USER_CODES_MASTER_USER;
+    }
+    if ( userId == USER_CODES_NO_USER ) {
+        return false;
     }
+    eventLogUserWrite( "CODE_OK", userId );
     return true;
 }
 
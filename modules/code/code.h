@@ -5,7 +5,9 @@
 
 //=====[Declaration of public defines]=========================================
 
-#define CODE_NUMBER_OF_KEYS   4
+// Six digits, so that even with a full user code table a guess has about a
+// 1 in 650 chance of being someone's code (see USER_CODES_MAX_USERS)
+#define CODE_NUMBER_OF_KEYS   6
 
 //=====[Declaration of public data types]======================================
 
@@ -17,7 +19,10 @@ typedef enum{
 //=====[Declarations (prototypes) of public functions]=========================
 
 void codeWrite( char* newCodeSequence );
+bool codeSequenceCheck( const char* codeSequenceToCheck );
+bool codeMasterCheck( const char* codeToCompare );
 bool codeMatchFrom( codeOrigin_t codeOrigin );
+void codeLockoutReset();
 
 //=====[#include guards - end]=================================================
 
@@ -4,27 +4,121 @@
 
 #include "date_and_time.h"
 
+#include "text_format.h"
+
 //=====[Declaration of private defines]========================================
 
+#define SECONDS_PER_DAY    86400
+
 //=====[Declaration of private data types]=====================================
 
 //=====[Declaration and initialization of public global objects]===============
 
+// The low power ticker keeps counting through a deep sleep, where the
+// microsecond ticker stops, and a LowPowerTimer does not hold the deep sleep
+// lock that a Timer holds while it runs. The price is its resolution: it
+// counts in steps of the LSE-driven RTC, tens of microseconds, so the
+// shortest loop times read as zero or one step.
+LowPowerTimer monotonicClock;
+
 //=====[Declaration of external public global variables]=======================
 
 //=====[Declaration and initialization of public global variables]=============
 
 //=====[Declaration and initialization of private global variables]============
 
+// The wall clock is the monotonic clock mapped onto the epoch: at the
+// monotonic instant monotonicAnchor_us it read epochAnchor_us, and it runs
+// rate_ppb faster than the monotonic clock. The anchor comes from the RTC,
+// in whole seconds, until a time synchronization adjusts it.
+static int64_t epochAnchor_us = 0;
+static uint64_t monotonicAnchor_us = 0;
+static int32_t rate_ppb = 0;
+
+// The current time already formatted, so that printing it is a copy
+static char dateAndTimeText[DATE_AND_TIME_TEXT_LENGTH + 1] = "";
+static time_t dateAndTimeTextSeconds = -1;
+
+static const char* const weekDayNames[7] = {
+    "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat",
+};
+static const char* const monthNames[12] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec",
+};
+
 //=====[Declarations (prototypes) of private functions]========================
 
+static void dateAndTimeAnchorUpdate();
+static void dateAndTimeTextUpdate();
+
 //=====[Implementations of public functions]===================================
 
-char* dateAndTimeRead()
+void dateAndTimeInit()
+{
+    monotonicClock.start();
+    dateAndTimeAnchorUpdate();
+}
+
+// Reformats the cached text when the second has changed
+void dateAndTimeUpdate()
+{
+    dateAndTimeTextUpdate();
+}
+
+// Copies the current date and time, in the ctime() format, into str, which
+// must hold DATE_AND_TIME_TEXT_LENGTH + 1 characters
+void dateAndTimeRead( char* str )
 {
-    time_t epochSeconds;
-    epochSeconds = time(NULL);
-    return ctime(&epochSeconds);    
+    dateAndTimeTextUpdate();
+    strcpy( str, dateAndTimeText );
+}
+
+// Reentrant replacement of ctime() for UTC: writes the ctime() text of
+// epochSeconds at str and returns a pointer to its terminator. The civil
+// date comes from day arithmetic on 400-year eras, with no calendar tables
+// and no loops.
+char* dateAndTimeFormat( char* str, time_t epochSeconds )
+{
+    int64_t days = epochSeconds / SECONDS_PER_DAY;
+    int64_t secondOfDay = epochSeconds % SECONDS_PER_DAY;
+    if ( secondOfDay < 0 ) {
+        secondOfDay += SECONDS_PER_DAY;
+        days--;
+    }
+
+    // 1970-01-01 was a Thursday
+    int weekDay = (int)( ( days % 7 + 11 ) % 7 );
+
+    // Days since 0000-03-01, so that the leap day ends each year
+    int64_t shiftedDays = days + 719468;
+    int64_t era = ( shiftedDays >= 0 ? shiftedDays : shiftedDays - 146096 ) /
+                  146097;
+    int dayOfEra = (int)( shiftedDays - era * 146097 );
+    int yearOfEra = ( dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 -
+                      dayOfEra / 146096 ) / 365;
+    int dayOfYear = dayOfEra - ( 365 * yearOfEra + yearOfEra / 4 -
+                                 yearOfEra / 100 );
+    int shiftedMonth = ( 5 * dayOfYear + 2 ) / 153;
+    int day = dayOfYear - ( 153 * shiftedMonth + 2 ) / 5 + 1;
+    int month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+    long year = (long)( yearOfEra + era * 400 ) + ( month <= 2 ? 1 : 0 );
+
+    str = textFormatString( str, weekDayNames[weekDay] );
+    str = textFormatString( str, " " );
+    str = textFormatString( str, monthNames[month - 1] );
+    str = textFormatString( str, day < 10 ? "  " : " " );
+    str = textFormatInt( str, day );
+    str = textFormatString( str, " " );
+    str = textFormatZeroPadded( str, (unsigned long)( secondOfDay / 3600 ), 2 );
+    str = textFormatString( str, ":" );
+    str = textFormatZeroPadded( str,
+                                (unsigned long)( secondOfDay / 60 % 60 ), 2 );
+    str = textFormatString( str, ":" );
+    str = textFormatZeroPadded( str, (unsigned long)( secondOfDay % 60 ), 2 );
+    str = textFormatString( str, " " );
+    str = textFormatInt( str, year );
+    return textFormatString( str, "\n" );
 }
 
 void dateAndTimeWrite( int year, int month, int day, 
@@ -42,7 +136,92 @@ void dateAndTimeWrite( int year, int month, int day,
     rtcTime.tm_isdst = -1;
 
     set_time( mktime( &rtcTime ) );
+    dateAndTimeAnchorUpdate();
+    dateAndTimeTextUpdate();
+}
+
+// Sets the RTC from seconds since 1970-01-01 UTC
+bool dateAndTimeEpochWrite( time_t epochSeconds )
+{
+    if ( epochSeconds < DATE_AND_TIME_EPOCH_MIN ||
+         epochSeconds > DATE_AND_TIME_EPOCH_MAX ) {
+        return false;
+    }
+    set_time( epochSeconds );
+    dateAndTimeAnchorUpdate();
+    dateAndTimeTextUpdate();
+    return true;
+}
+
+uint64_t dateAndTimeMonotonicRead()
+{
+    return monotonicClock.elapsed_time().count();
+}
+
+time_t dateAndTimeMonotonicToEpoch( uint64_t monotonic_us )
+{
+    int64_t epoch_us = dateAndTimeMonotonicToEpochUs( monotonic_us );
+    time_t epochSeconds = (time_t)( epoch_us / 1000000 );
+    if ( epoch_us % 1000000 < 0 ) {
+        epochSeconds--;
+    }
+    return epochSeconds;
+}
+
+int64_t dateAndTimeEpochUsRead()
+{
+    return dateAndTimeMonotonicToEpochUs( dateAndTimeMonotonicRead() );
+}
+
+int64_t dateAndTimeMonotonicToEpochUs( uint64_t monotonic_us )
+{
+    // Signed difference: instants taken before the last anchor map backwards
+    int64_t elapsed_us = (int64_t)( monotonic_us - monotonicAnchor_us );
+
+    // Split so that the product cannot overflow over months of uptime
+    int64_t correction_us = ( elapsed_us / 1000000 ) * rate_ppb / 1000 +
+                            ( elapsed_us % 1000000 ) * rate_ppb / 1000000000;
+    return epochAnchor_us + elapsed_us + correction_us;
+}
+
+// Moves the wall clock by step_us and makes it run rate_ppb faster than
+// the monotonic clock from now on. The RTC follows, to the second, so the
+// correction survives a reset.
+void dateAndTimeAdjust( int64_t step_us, int32_t newRate_ppb )
+{
+    uint64_t monotonic_us = dateAndTimeMonotonicRead();
+
+    epochAnchor_us = dateAndTimeMonotonicToEpochUs( monotonic_us ) + step_us;
+    monotonicAnchor_us = monotonic_us;
+    rate_ppb = newRate_ppb;
+    set_time( (time_t)( epochAnchor_us / 1000000 ) );
+    dateAndTimeTextUpdate();
+}
+
+int32_t dateAndTimeRateRead()
+{
+    return rate_ppb;
 }
 
 //=====[Implementations of private functions]==================================
 
+// Pairs the RTC seconds with the monotonic clock so that later conversions
+// need no time() call
+static void dateAndTimeAnchorUpdate()
+{
+    monotonicAnchor_us = dateAndTimeMonotonicRead();
+    epochAnchor_us = (int64_t)time(NULL) * 1000000;
+}
+
+// The current second comes from the monotonic anchor, not from time()
+static void dateAndTimeTextUpdate()
+{
+    time_t epochSeconds =
+        dateAndTimeMonotonicToEpoch( dateAndTimeMonotonicRead() );
+
+    if ( epochSeconds != dateAndTimeTextSeconds ) {
+        dateAndTimeFormat( dateAndTimeText, epochSeconds );
+        dateAndTimeTextSeconds = epochSeconds;
+    }
+}
+
@@ -3,16 +3,42 @@
 #ifndef _DATE_AND_TIME_H_
 #define _DATE_AND_TIME_H_
 
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+#include <time.h>
+
 //=====[Declaration of public defines]=========================================
 
+// Range accepted by dateAndTimeEpochWrite(): 2000-01-01 to 2037-12-31, so
+// that any accepted value fits a 32-bit signed time_t
+#define DATE_AND_TIME_EPOCH_MIN    946684800
+#define DATE_AND_TIME_EPOCH_MAX   2145916799
+
+// "Thu Jan  1 00:00:00 1970\n", as ctime() writes it, without the
+// terminator
+#define DATE_AND_TIME_TEXT_LENGTH    25
+
 //=====[Declaration of public data types]======================================
 
 //=====[Declarations (prototypes) of public functions]=========================
 
-char* dateAndTimeRead();
+void dateAndTimeInit();
+void dateAndTimeUpdate();
+
+void dateAndTimeRead( char* str );
+char* dateAndTimeFormat( char* str, time_t epochSeconds );
 
 void dateAndTimeWrite( int year, int month, int day, 
                        int hour, int minute, int second );
+bool dateAndTimeEpochWrite( time_t epochSeconds );
+
+uint64_t dateAndTimeMonotonicRead();
+time_t dateAndTimeMonotonicToEpoch( uint64_t monotonic_us );
+int64_t dateAndTimeEpochUsRead();
+int64_t dateAndTimeMonotonicToEpochUs( uint64_t monotonic_us );
+void dateAndTimeAdjust( int64_t step_us, int32_t newRate_ppb );
+int32_t dateAndTimeRateRead();
 
 //=====[#include guards - end]=================================================
 
@@ -10,14 +10,17 @@
 #include "user_interface.h"
 #include "date_and_time.h"
 #include "pc_serial_com.h"
+#include "text_format.h"
 
 //=====[Declaration of private defines]========================================
 
 //=====[Declaration of private data types]=====================================
 
 typedef struct systemEvent {
+    uint64_t monotonic_us;
     time_t seconds;
     char typeOfEvent[EVENT_LOG_NAME_MAX_LENGTH];
+    int userId;
 } systemEvent_t;
 
 //=====[Declaration and initialization of public global objects]===============
@@ -34,6 +37,7 @@ static bool tempLastState  = OFF;
 static bool ICLastState    = OFF;
 static bool SBLastState    = OFF;
 static int eventsIndex     = 0;
+static uint32_t numberOfLoggedEvents = 0;
 static systemEvent_t arrayOfStoredEvents[EVENT_LOG_MAX_STORAGE];
 
 //=====[Declarations (prototypes) of private functions]========================
@@ -41,6 +45,7 @@ static systemEvent_t arrayOfStoredEvents[EVENT_LOG_MAX_STORAGE];
 static void eventLogElementStateUpdate( bool lastState,
                                         bool currentState,
                                         const char* elementName );
+static void eventLogStore( const char* eventName, int userId );
 
 //=====[Implementations of public functions]===================================
 
@@ -78,8 +83,31 @@ void eventLogRead( int index, char* str )
     strcat( str, "Event = " );
     strcat( str, arrayOfStoredEvents[index].typeOfEvent );
     strcat( str, "\r\nDate and Time = " );
-    strcat( str, ctime(&arrayOfStoredEvents[index].seconds) );
-    strcat( str, "\r\n" );
+    char* end = dateAndTimeFormat( str + strlen(str),
+                                   arrayOfStoredEvents[index].seconds );
+    end = textFormatString( end, "Monotonic time = " );
+    end = textFormatUint64( end, arrayOfStoredEvents[index].monotonic_us / 1000000 );
+    end = textFormatString( end, "." );
+    end = textFormatZeroPadded( end,
+              (unsigned long)( arrayOfStoredEvents[index].monotonic_us % 1000000 ), 6 );
+    end = textFormatString( end, " s\r\n" );
+    if ( arrayOfStoredEvents[index].userId != EVENT_LOG_NO_USER ) {
+        end = textFormatString( end, "User = " );
+        end = textFormatInt( end, arrayOfStoredEvents[index].userId );
+        textFormatString( end, "\r\n" );
+    }
+}
+
+// Counts every event since reset; unlike the ring index it never wraps back
+// when the log is full
+uint32_t eventLogNumberOfLoggedEventsRead()
+{
+    return numberOfLoggedEvents;
+}
+
+uint64_t eventLogMonotonicTimeRead( int index )
+{
+    return arrayOfStoredEvents[index].monotonic_us;
 }
 
 void eventLogWrite( bool currentState, const char* elementName )
@@ -92,17 +120,14 @@ void eventLogWrite( bool currentState, const char* elementName )
     } else {
         strcat( eventAndStateStr, "_OFF" );
     }
+    eventLogStore( eventAndStateStr, EVENT_LOG_NO_USER );
+}
 
-    arrayOfStoredEvents[eventsIndex].seconds = time(NULL);
-    strcpy( arrayOfStoredEvents[eventsIndex].typeOfEvent, eventAndStateStr );
-    if ( eventsIndex < EVENT_LOG_MAX_STORAGE - 1 ) {
-        eventsIndex++;
-    } else {
-        eventsIndex = 0;
-    }
-
-    pcSerialComStringWrite(eventAndStateStr);
-    pcSerialComStringWrite("\r\n");
+// For actions taken by a user, such as a deactivation with a user code;
+// eventName must fit EVENT_LOG_NAME_MAX_LENGTH
+void eventLogUserWrite( const char* eventName, int userId )
+{
+    eventLogStore( eventName, userId );
 }
 
 //=====[Implementations of private functions]==================================
@@ -114,4 +139,32 @@ static void eventLogElementStateUpdate( bool lastState,
     if ( lastState != currentState ) {        
         eventLogWrite( currentState, elementName );       
     }
+}
+
+// Timestamps and stores the event, then notifies every console
+static void eventLogStore( const char* eventName, int userId )
+{
+    char notificationStr[EVENT_LOG_NAME_MAX_LENGTH + USER_STR_LENGTH] = "";
+    char* end;
+
+    uint64_t monotonic_us = dateAndTimeMonotonicRead();
+    arrayOfStoredEvents[eventsIndex].monotonic_us = monotonic_us;
+    arrayOfStoredEvents[eventsIndex].seconds =
+        dateAndTimeMonotonicToEpoch( monotonic_us );
+    strcpy( arrayOfStoredEvents[eventsIndex].typeOfEvent, eventName );
+    arrayOfStoredEvents[eventsIndex].userId = userId;
+    if ( eventsIndex < EVENT_LOG_MAX_STORAGE - 1 ) {
+        eventsIndex++;
+    } else {
+        eventsIndex = 0;
+    }
+    numberOfLoggedEvents++;
+
+    end = textFormatString( notificationStr, eventName );
+    if ( userId != EVENT_LOG_NO_USER ) {
+        end = textFormatString( end, " user " );
+        end = textFormatInt( end, userId );
+    }
+    textFormatString( end, "\r\n" );
+    pcSerialComNotificationWrite( notificationStr );
 }
\ No newline at end of file
@@ -3,6 +3,10 @@
 #ifndef _EVENT_LOG_H_
 #define _EVENT_LOG_H_
 
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
 //=====[Declaration of public defines]=========================================
 
 #define EVENT_LOG_MAX_STORAGE        20
@@ -11,20 +15,30 @@
 #define DATE_AND_TIME_STR_LENGTH     18
 #define CTIME_STR_LENGTH             25
 #define NEW_LINE_STR_LENGTH           3
+#define MONOTONIC_TIME_STR_LENGTH    40
+#define USER_STR_LENGTH              16
 #define EVENT_STR_LENGTH             (EVENT_HEAD_STR_LENGTH + \
                                       EVENT_LOG_NAME_MAX_LENGTH + \
                                       DATE_AND_TIME_STR_LENGTH  + \
                                       CTIME_STR_LENGTH + \
+                                      MONOTONIC_TIME_STR_LENGTH + \
+                                      USER_STR_LENGTH + \
                                       NEW_LINE_STR_LENGTH)
 
+// User of events that are not caused by a user
+#define EVENT_LOG_NO_USER            -1
+
 //=====[Declaration of public data types]======================================
 
 //=====[Declarations (prototypes) of public functions]=========================
 
 void eventLogUpdate();
 int eventLogNumberOfStoredEvents();
+uint32_t eventLogNumberOfLoggedEventsRead();
 void eventLogRead( int index, char* str );
+uint64_t eventLogMonotonicTimeRead( int index );
 void eventLogWrite( bool currentState, const char* elementName );
+void eventLogUserWrite( const char* eventName, int userId );
 
 //=====[#include guards - end]=================================================
 
@@ -13,19 +13,24 @@
 #include "temperature_sensor.h"
 #include "gas_sensor.h"
 #include "matrix_keypad.h"
+#include "power_manager.h"
+#include "metrics.h"
+
+#include <atomic>
 
 //=====[Declaration of private defines]========================================
 
-#define TEMPERATURE_C_LIMIT_ALARM               50.0
-#define STROBE_TIME_GAS               1000
-#define STROBE_TIME_OVER_TEMP          500
-#define STROBE_TIME_GAS_AND_OVER_TEMP  100
+// The temperature is sampled at every update, so at least this often while
+// the superloop stands by
+#define FIRE_ALARM_SAMPLE_PERIOD_MAX_MS    1000
 
 //=====[Declaration of private data types]=====================================
 
 //=====[Declaration and initialization of public global objects]===============
 
-DigitalIn alarmTestButton(BUTTON1);
+// BUTTON1 is PC_13, on EXTI line 13, which the keypad leaves free. A press
+// wakes the panel and is latched, so even a short one is seen.
+InterruptIn alarmTestButton(BUTTON1);
 
 //=====[Declaration of external public global variables]=======================
 
@@ -38,12 +43,37 @@ static bool overTemperatureDetected      = OFF;
 static bool gasDetectorState             = OFF;
 static bool overTemperatureDetectorState = OFF;
 
+static fireAlarmSettings_t fireAlarmSettings = {
+    TEMPERATURE_C_LIMIT_ALARM,
+    STROBE_TIME_GAS,
+    STROBE_TIME_OVER_TEMP,
+    STROBE_TIME_GAS_AND_OVER_TEMP,
+};
+
+// Seqlock with two copies. Readers take the copy selected by the low bit
+// of the sequence, which is never the one being written, and retry if the
+// sequence moved meanwhile. A reader that interrupts the publication
+// therefore gets the previous update at once instead of spinning on it.
+static std::atomic<uint32_t> snapshotSequence( 0 );
+static fireAlarmSnapshot_t snapshots[2];
+static uint32_t numberOfUpdates = 0;
+
+// Start of the alarm time not yet added to METRICS_COUNTER_ALARM_TIME_MS
+static uint64_t alarmTimeFrom_us = 0;
+
+static uint64_t lastUpdate_us = 0;
+static std::atomic<bool> alarmTestButtonPressed( false );
+
 //=====[Declarations (prototypes) of private functions]========================
 
 static void fireAlarmActivationUpdate();
 static void fireAlarmDeactivationUpdate();
 static void fireAlarmDeactivate();
 static int fireAlarmStrobeTime();
+static bool fireAlarmStrobeTimeCheck( int strobeTime_ms );
+static void fireAlarmSnapshotPublish();
+static void fireAlarmMetricsUpdate();
+static void fireAlarmTestButtonIsr();
 
 //=====[Implementations of public functions]===================================
 
@@ -56,14 +86,25 @@ void fireAlarmInit()
     strobeLightInit();    
     
     alarmTestButton.mode(PullDown); 
+    alarmTestButton.rise( &fireAlarmTestButtonIsr );
+    fireAlarmSnapshotPublish();
 }
 
 void fireAlarmUpdate()
 {
+    lastUpdate_us = dateAndTimeMonotonicRead();
     fireAlarmActivationUpdate();
     fireAlarmDeactivationUpdate();
     sirenUpdate( fireAlarmStrobeTime() );
     strobeLightUpdate( fireAlarmStrobeTime() );    
+    fireAlarmMetricsUpdate();
+    fireAlarmSnapshotPublish();
+}
+
+// When the next update is due to sample the temperature
+uint64_t fireAlarmDeadlineRead()
+{
+    return lastUpdate_us + (uint64_t)FIRE_ALARM_SAMPLE_PERIOD_MAX_MS * 1000;
 }
 
 bool gasDetectorStateRead()
@@ -86,17 +127,78 @@ bool overTemperatureDetectedRead()
     return overTemperatureDetected;
 }
 
+int fireAlarmCauseRead()
+{
+    int cause = 0;
+    if ( gasDetected ) {
+        cause |= FIRE_ALARM_CAUSE_GAS;
+    }
+    if ( overTemperatureDetected ) {
+        cause |= FIRE_ALARM_CAUSE_OVER_TEMP;
+    }
+    return cause;
+}
+
+// Acknowledge from a supervisory system, equivalent to a correct code
+void fireAlarmRemoteDeactivate()
+{
+    if ( sirenStateRead() ) {
+        fireAlarmDeactivate();
+    }
+}
+
+void fireAlarmSettingsRead( fireAlarmSettings_t* settings )
+{
+    *settings = fireAlarmSettings;
+}
+
+bool fireAlarmSettingsCheck( const fireAlarmSettings_t* settings )
+{
+    return settings->temperatureLimitC >= FIRE_ALARM_TEMPERATURE_C_LIMIT_MIN &&
+           settings->temperatureLimitC <= FIRE_ALARM_TEMPERATURE_C_LIMIT_MAX &&
+           fireAlarmStrobeTimeCheck( settings->strobeTimeGas_ms ) &&
+           fireAlarmStrobeTimeCheck( settings->strobeTimeOverTemp_ms ) &&
+           fireAlarmStrobeTimeCheck( settings->strobeTimeGasAndOverTemp_ms );
+}
+
+// All settings are replaced together, or none if any is out of range
+bool fireAlarmSettingsWrite( const fireAlarmSettings_t* settings )
+{
+    if ( !fireAlarmSettingsCheck( settings ) ) {
+        return false;
+    }
+    fireAlarmSettings = *settings;
+    return true;
+}
+
+// Lock-free and safe from any thread or interrupt priority
+void fireAlarmSnapshotRead( fireAlarmSnapshot_t* snapshot )
+{
+    uint32_t sequence;
+
+    do {
+        sequence = snapshotSequence.load( std::memory_order_acquire );
+        *snapshot = snapshots[sequence & 1];
+        std::atomic_thread_fence( std::memory_order_acquire );
+    } while ( snapshotSequence.load( std::memory_order_relaxed ) != sequence );
+}
+
 //=====[Implementations of private functions]==================================
 
 static void fireAlarmActivationUpdate()
 {
+    bool alarmWasActive = sirenStateRead();
+
     temperatureSensorUpdate();
     gasSensorUpdate();
 
     overTemperatureDetectorState = temperatureSensorReadCelsius() > 
-                                   TEMPERATURE_C_LIMIT_ALARM;
+                                   fireAlarmSettings.temperatureLimitC;
 
     if ( overTemperatureDetectorState ) {
+        if ( !overTemperatureDetected ) {
+            metricsCounterIncrement( METRICS_COUNTER_ALARM_TRIPS_OVER_TEMP );
+        }
         overTemperatureDetected = ON;
         sirenStateWrite(ON);// define el estado de la alarma en ON
         strobeLightStateWrite(ON);
@@ -105,12 +207,18 @@ static void fireAlarmActivationUpdate()
     gasDetectorState = !gasSensorRead();
 
     if ( gasDetectorState ) {
+        if ( !gasDetected ) {
+            metricsCounterIncrement( METRICS_COUNTER_ALARM_TRIPS_GAS );
+        }
         gasDetected = ON;
         sirenStateWrite(ON);
         strobeLightStateWrite(ON);
     }
     //alarmTestButton es la entrada digital para probar la alarma
-    if( alarmTestButton ) {             
+    if( alarmTestButtonPressed.exchange( false ) || alarmTestButton ) {
+        if ( !alarmWasActive ) {
+            metricsCounterIncrement( METRICS_COUNTER_ALARM_TRIPS_TEST );
+        }
         overTemperatureDetected = ON;
         gasDetected = ON;
         sirenStateWrite(ON);
@@ -139,12 +247,70 @@ static void fireAlarmDeactivate()
 static int fireAlarmStrobeTime()
 {
     if( gasDetectedRead() && overTemperatureDetectedRead() ) {
-        return STROBE_TIME_GAS_AND_OVER_TEMP;
+        return fireAlarmSettings.strobeTimeGasAndOverTemp_ms;
     } else if ( gasDetectedRead() ) {
-        return STROBE_TIME_GAS;
+        return fireAlarmSettings.strobeTimeGas_ms;
     } else if ( overTemperatureDetectedRead() ) {
-        return STROBE_TIME_OVER_TEMP;
+        return fireAlarmSettings.strobeTimeOverTemp_ms;
     } else {
         return 0;
     }
 }
+
+static bool fireAlarmStrobeTimeCheck( int strobeTime_ms )
+{
+    return strobeTime_ms >= FIRE_ALARM_STROBE_TIME_MIN_MS &&
+           strobeTime_ms <= FIRE_ALARM_STROBE_TIME_MAX_MS;
+}
+
+// Called once per update, after the user interface and the alarm logic have
+// both run, so the snapshot never mixes states from different ticks
+static void fireAlarmSnapshotPublish()
+{
+    fireAlarmSnapshot_t snapshot;
+    uint32_t sequence = snapshotSequence.load( std::memory_order_relaxed );
+
+    numberOfUpdates++;
+    snapshot.updateNumber = numberOfUpdates;
+    snapshot.monotonic_us = dateAndTimeMonotonicRead();
+    snapshot.alarm = sirenStateRead();
+    snapshot.gasDetector = gasDetectorState;
+    snapshot.overTemperatureDetector = overTemperatureDetectorState;
+    snapshot.gasDetected = gasDetected;
+    snapshot.overTemperatureDetected = overTemperatureDetected;
+    snapshot.incorrectCode = incorrectCodeStateRead();
+    snapshot.systemBlocked = systemBlockedStateRead();
+    snapshot.cause = fireAlarmCauseRead();
+    snapshot.temperatureC = temperatureSensorReadCelsius();
+
+    // Odd: readers move to copy 1 while copy 0 is written, then back
+    snapshotSequence.store( sequence + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+    snapshots[0] = snapshot;
+    snapshotSequence.store( sequence + 2, std::memory_order_release );
+    std::atomic_thread_fence( std::memory_order_release );
+    snapshots[1] = snapshot;
+}
+
+// Alarm time is added in whole milliseconds; the remainder is carried over
+static void fireAlarmMetricsUpdate()
+{
+    uint64_t now_us = dateAndTimeMonotonicRead();
+    uint32_t alarmTime_ms;
+
+    if ( sirenStateRead() ) {
+        alarmTime_ms = (uint32_t)( ( now_us - alarmTimeFrom_us ) / 1000 );
+        metricsCounterAdd( METRICS_COUNTER_ALARM_TIME_MS, alarmTime_ms );
+        alarmTimeFrom_us += (uint64_t)alarmTime_ms * 1000;
+    } else {
+        alarmTimeFrom_us = now_us;
+    }
+    metricsGaugeWrite( METRICS_GAUGE_TEMPERATURE_DC,
+                       (int32_t)( temperatureSensorReadCelsius() * 10.0f ) );
+}
+
+static void fireAlarmTestButtonIsr()
+{
+    alarmTestButtonPressed = true;
+    powerManagerWakeUp();
+}
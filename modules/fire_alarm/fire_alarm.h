@@ -3,18 +3,67 @@
 #ifndef _FIRE_ALARM_H_
 #define _FIRE_ALARM_H_
 
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
 //=====[Declaration of public defines]=========================================
 
+// Bits of fireAlarmCauseRead(), latched until the alarm is deactivated
+#define FIRE_ALARM_CAUSE_GAS          (1 << 0)
+#define FIRE_ALARM_CAUSE_OVER_TEMP    (1 << 1)
+
+// Default settings
+#define TEMPERATURE_C_LIMIT_ALARM               50.0
+#define STROBE_TIME_GAS               1000
+#define STROBE_TIME_OVER_TEMP          500
+#define STROBE_TIME_GAS_AND_OVER_TEMP  100
+
+// Accepted ranges of fireAlarmSettingsWrite()
+#define FIRE_ALARM_TEMPERATURE_C_LIMIT_MIN     20.0
+#define FIRE_ALARM_TEMPERATURE_C_LIMIT_MAX    125.0
+#define FIRE_ALARM_STROBE_TIME_MIN_MS           20
+#define FIRE_ALARM_STROBE_TIME_MAX_MS        10000
+
 //=====[Declaration of public data types]======================================
 
+typedef struct fireAlarmSettings {
+    float temperatureLimitC;
+    int strobeTimeGas_ms;
+    int strobeTimeOverTemp_ms;
+    int strobeTimeGasAndOverTemp_ms;
+} fireAlarmSettings_t;
+
+// Everything the alarm decided in one update, taken together
+typedef struct fireAlarmSnapshot {
+    uint32_t updateNumber;
+    uint64_t monotonic_us;
+    bool alarm;
+    bool gasDetector;
+    bool overTemperatureDetector;
+    bool gasDetected;
+    bool overTemperatureDetected;
+    bool incorrectCode;
+    bool systemBlocked;
+    int cause;
+    float temperatureC;
+} fireAlarmSnapshot_t;
+
 //=====[Declarations (prototypes) of public functions]=========================
 
 void fireAlarmInit();
 void fireAlarmUpdate();
+uint64_t fireAlarmDeadlineRead();
 bool gasDetectorStateRead();
 bool overTemperatureDetectorStateRead();
 bool gasDetectedRead();
 bool overTemperatureDetectedRead();
+int fireAlarmCauseRead();
+void fireAlarmRemoteDeactivate();
+void fireAlarmSettingsRead( fireAlarmSettings_t* settings );
+bool fireAlarmSettingsCheck( const fireAlarmSettings_t* settings );
+bool fireAlarmSettingsWrite( const fireAlarmSettings_t* settings );
+void fireAlarmSnapshotRead( fireAlarmSnapshot_t* snapshot );
 
 //=====[#include guards - end]=================================================
 
@@ -4,13 +4,21 @@
 
 #include "gas_sensor.h"
 
+#include "spsc_queue.h"
+#include "power_manager.h"
+
 //=====[Declaration of private defines]========================================
 
+// A power of two
+#define GAS_SENSOR_EDGE_QUEUE_SIZE    8
+
 //=====[Declaration of private data types]=====================================
 
 //=====[Declaration and initialization of public global objects]===============
 
-DigitalIn mq2(PE_12);
+// STM32 pins share an EXTI line per pin number across ports, and lines 6,
+// 10, 12 and 15 are taken by the keypad columns, so the MQ-2 is on PE_11
+InterruptIn mq2(PE_11);
 
 //=====[Declaration of external public global variables]=======================
 
@@ -18,23 +26,71 @@ DigitalIn mq2(PE_12);
 
 //=====[Declaration and initialization of private global variables]============
 
+// Levels after each edge, from the edge interrupts to gasSensorUpdate()
+static SpscQueue<bool, GAS_SENSOR_EDGE_QUEUE_SIZE> gasSensorEdges;
+static volatile uint32_t gasSensorDroppedEdges = 0;
+static uint32_t gasSensorDroppedEdgesSeen = 0;
+static bool gasSensorLevel = true;
+static bool gasSensorReportedLevel = true;
+
 //=====[Declarations (prototypes) of private functions]========================
 
+static void gasSensorFallIsr();
+static void gasSensorRiseIsr();
+static void gasSensorEdgeWrite( bool level );
+
 //=====[Implementations of public functions]===================================
 
 void gasSensorInit()
 {
-    //Para futuras necesidades de inicializacion
+    gasSensorLevel = mq2;
+    gasSensorReportedLevel = gasSensorLevel;
+    mq2.fall( &gasSensorFallIsr );
+    mq2.rise( &gasSensorRiseIsr );
 }
 
+// The output is active low. A detection shorter than the update period is
+// still reported for one update instead of falling between two reads.
 void gasSensorUpdate()
 {
-    //Para futuras necesidades de actualizacion
+    bool level;
+    bool detectionSeen = false;
+
+    while ( gasSensorEdges.pop( &level ) ) {
+        gasSensorLevel = level;
+        if ( !level ) {
+            detectionSeen = true;
+        }
+    }
+    // Edges were lost, so the last one queued may not be the current level
+    if ( gasSensorDroppedEdges != gasSensorDroppedEdgesSeen ) {
+        gasSensorDroppedEdgesSeen = gasSensorDroppedEdges;
+        gasSensorLevel = mq2;
+    }
+    gasSensorReportedLevel = gasSensorLevel && !detectionSeen;
 }
 
 bool gasSensorRead()
 {
-    return mq2;
+    return gasSensorReportedLevel;
 }
 
-//=====[Implementations of private functions]==================================
\ No newline at end of file
+//=====[Implementations of private functions]==================================
+
+static void gasSensorFallIsr()
+{
+    gasSensorEdgeWrite( false );
+}
+
+static void gasSensorRiseIsr()
+{
+    gasSensorEdgeWrite( true );
+}
+
+static void gasSensorEdgeWrite( bool level )
+{
+    if ( !gasSensorEdges.push( level ) ) {
+        gasSensorDroppedEdges++;
+    }
+    powerManagerWakeUp();
+}
\ No newline at end of file
@@ -6,25 +6,56 @@
 #include "matrix_keypad.h"
 
 #include "date_and_time.h"
+#include "spsc_queue.h"
+#include "power_manager.h"
+#include "trace_buffer.h"
+#include "metrics.h"
 
 //=====[Declaration of private defines]========================================
 
 #define MATRIX_KEYPAD_NUMBER_OF_ROWS    4
 #define MATRIX_KEYPAD_NUMBER_OF_COLS    4
-#define DEBOUNCE_KEY_TIME_MS        40
+#define MATRIX_KEYPAD_NUMBER_OF_KEYS    16
+
+// Rows: PB_3, PB_5, PC_7, PA_15
+#define KEYPAD_ROWS_PORTA_MASK    (1 << 15)
+#define KEYPAD_ROWS_PORTB_MASK    ((1 << 3) | (1 << 5))
+#define KEYPAD_ROWS_PORTC_MASK    (1 << 7)
+
+// Columns: PB_12, PB_10, PB_15, PC_6. Column 1 is on PB_10 rather than
+// PB_13 to leave EXTI line 13 to the alarm test button on PC_13.
+#define KEYPAD_COLS_PORTB_MASK    ((1 << 10) | (1 << 12) | (1 << 15))
+#define KEYPAD_COLS_PORTC_MASK    (1 << 6)
 
 //=====[Declaration of private data types]=====================================
 // estados para la lectura del teclado.
 typedef enum {
+    MATRIX_KEYPAD_IDLE,
     MATRIX_KEYPAD_SCANNING,
-    MATRIX_KEYPAD_DEBOUNCE,
-    MATRIX_KEYPAD_KEY_HOLD_PRESSED
 } matrixKeypadState_t;
 
+// What each row port is set to while one row is driven low
+typedef struct matrixKeypadRowPattern {
+    int portA;
+    int portB;
+    int portC;
+} matrixKeypadRowPattern_t;
+
 //=====[Declaration and initialization of public global objects]===============
 
-DigitalOut keypadRowPins[MATRIX_KEYPAD_NUMBER_OF_ROWS] = {PB_3, PB_5, PC_7, PA_15};
-DigitalIn keypadColPins[MATRIX_KEYPAD_NUMBER_OF_COLS]  = {PB_12, PB_13, PB_15, PC_6};
+// Each port access sets or reads all the keypad pins of that port at once
+PortOut keypadRowsPortA(PortA, KEYPAD_ROWS_PORTA_MASK);
+PortOut keypadRowsPortB(PortB, KEYPAD_ROWS_PORTB_MASK);
+PortOut keypadRowsPortC(PortC, KEYPAD_ROWS_PORTC_MASK);
+PortIn keypadColsPortB(PortB, KEYPAD_COLS_PORTB_MASK);
+PortIn keypadColsPortC(PortC, KEYPAD_COLS_PORTC_MASK);
+
+// The columns are also wake sources, and set the pull-ups. InterruptIn
+// cannot be copied, so they cannot be brace-initialised as an array.
+InterruptIn keypadColPin0(PB_12);
+InterruptIn keypadColPin1(PB_10);
+InterruptIn keypadColPin2(PB_15);
+InterruptIn keypadColPin3(PC_6);
 
 //=====[Declaration of external public global variables]=======================
 
@@ -32,110 +63,235 @@ DigitalIn keypadColPins[MATRIX_KEYPAD_NUMBER_OF_COLS]  = {PB_12, PB_13, PB_15, P
 
 //=====[Declaration and initialization of private global variables]============
 
+static InterruptIn* const keypadColPins[MATRIX_KEYPAD_NUMBER_OF_COLS] = {
+    &keypadColPin0, &keypadColPin1, &keypadColPin2, &keypadColPin3,
+};
+
+static const matrixKeypadRowPattern_t
+    matrixKeypadRowPatterns[MATRIX_KEYPAD_NUMBER_OF_ROWS] = {
+    { KEYPAD_ROWS_PORTA_MASK, 1 << 5, KEYPAD_ROWS_PORTC_MASK },
+    { KEYPAD_ROWS_PORTA_MASK, 1 << 3, KEYPAD_ROWS_PORTC_MASK },
+    { KEYPAD_ROWS_PORTA_MASK, KEYPAD_ROWS_PORTB_MASK, 0 },
+    { 0, KEYPAD_ROWS_PORTB_MASK, KEYPAD_ROWS_PORTC_MASK },
+};
+
+// Bit row * MATRIX_KEYPAD_NUMBER_OF_COLS + col of a key bitmap
+static const char matrixKeypadIndexToCharArray[MATRIX_KEYPAD_NUMBER_OF_KEYS] = {
+    '1', '2', '3', 'A',
+    '4', '5', '6', 'B',
+    '7', '8', '9', 'C',
+    '*', '0', '#', 'D',
+};
+
 static matrixKeypadState_t matrixKeypadState;
+static volatile bool keypadWakeUp = false;
 static int timeIncrement_ms = 0;
+static int debounceKeyTime_ms = DEBOUNCE_KEY_TIME_MS;
+
+// Debounced state of every key, and for each key how long its raw state
+// has disagreed with it
+static uint16_t keypadStableBitmap = 0;
+static int keypadDebounceTime_ms[MATRIX_KEYPAD_NUMBER_OF_KEYS];
+
+// Filled by the scan and drained by matrixKeypadEventRead(), both in the
+// superloop; no interrupt touches it
+static SpscQueue<matrixKeypadEvent_t, MATRIX_KEYPAD_EVENT_QUEUE_SIZE> keypadEvents;
+static uint32_t keypadDroppedEvents = 0;
 
 //=====[Declarations (prototypes) of private functions]========================
 
-static char matrixKeypadScan();
-static void matrixKeypadReset();
+static uint16_t matrixKeypadScan();
+static int matrixKeypadColumnsRead();
+static void matrixKeypadDebounce( uint16_t rawBitmap );
+static void matrixKeypadEventWrite( int keyIndex, bool pressed );
+static void matrixKeypadIdleEnter();
+static void matrixKeypadIdleExit();
+static void matrixKeypadWakeUpIsr();
 
 //=====[Implementations of public functions]===================================
 
 void matrixKeypadInit( int updateTime_ms )
 {
     timeIncrement_ms = updateTime_ms;
-    matrixKeypadState = MATRIX_KEYPAD_SCANNING;
     int pinIndex = 0;
     for( pinIndex=0; pinIndex<MATRIX_KEYPAD_NUMBER_OF_COLS; pinIndex++ ) {
-        (keypadColPins[pinIndex]).mode(PullUp);
+        keypadColPins[pinIndex]->mode(PullUp);
+        keypadColPins[pinIndex]->fall( &matrixKeypadWakeUpIsr );
+        keypadColPins[pinIndex]->disable_irq();
     }
+    matrixKeypadIdleEnter();
 }
 
-char matrixKeypadUpdate()
+// Scans the whole keypad in one pass and queues a press or release event
+// for every key whose state has been stable for the debounce time
+void matrixKeypadUpdate()
 {
-    static int accumulatedDebounceMatrixKeypadTime = 0;
-    static char matrixKeypadLastKeyPressed = '\0';
+    uint16_t rawBitmap;
 
-    char keyDetected = '\0';
-    char keyReleased = '\0';
-//maquina de estados para la lectura del teclado.
     switch( matrixKeypadState ) {
 
-    case MATRIX_KEYPAD_SCANNING:
-        keyDetected = matrixKeypadScan();
-        if( keyDetected != '\0' ) {
-            matrixKeypadLastKeyPressed = keyDetected;
-            accumulatedDebounceMatrixKeypadTime = 0;
-            matrixKeypadState = MATRIX_KEYPAD_DEBOUNCE;
+    // Nothing is scanned until a column interrupt reports a press
+    case MATRIX_KEYPAD_IDLE:
+        if( keypadWakeUp ) {
+            matrixKeypadIdleExit();
         }
         break;
 
-    case MATRIX_KEYPAD_DEBOUNCE:
-        if( accumulatedDebounceMatrixKeypadTime >=
-            DEBOUNCE_KEY_TIME_MS ) {
-            keyDetected = matrixKeypadScan();
-            if( keyDetected == matrixKeypadLastKeyPressed ) {
-                matrixKeypadState = MATRIX_KEYPAD_KEY_HOLD_PRESSED;
-            } else {
-                matrixKeypadState = MATRIX_KEYPAD_SCANNING;
-            }
-        }
-        accumulatedDebounceMatrixKeypadTime =
-            accumulatedDebounceMatrixKeypadTime + timeIncrement_ms;
-        break;
-
-    case MATRIX_KEYPAD_KEY_HOLD_PRESSED:
-        keyDetected = matrixKeypadScan();
-        if( keyDetected != matrixKeypadLastKeyPressed ) {
-            if( keyDetected == '\0' ) {
-                keyReleased = matrixKeypadLastKeyPressed;
-            }
-            matrixKeypadState = MATRIX_KEYPAD_SCANNING;
+    case MATRIX_KEYPAD_SCANNING:
+        rawBitmap = matrixKeypadScan();
+        matrixKeypadDebounce( rawBitmap );
+        if( rawBitmap == 0 && keypadStableBitmap == 0 ) {
+            matrixKeypadIdleEnter();
         }
         break;
 
     default:
-        matrixKeypadReset();
+        matrixKeypadIdleExit();
         break;
     }
-    return keyReleased;
+}
+
+bool matrixKeypadEventRead( matrixKeypadEvent_t* event )
+{
+    return keypadEvents.pop( event );
+}
+
+// Debounced keys held down, bit row * 4 + col
+uint16_t matrixKeypadBitmapRead()
+{
+    return keypadStableBitmap;
+}
+
+uint32_t matrixKeypadDroppedEventsRead()
+{
+    return keypadDroppedEvents;
+}
+
+// True while the keypad only waits for a press, with no scanning to do
+bool matrixKeypadIdleRead()
+{
+    return matrixKeypadState == MATRIX_KEYPAD_IDLE;
+}
+
+bool matrixKeypadDebounceTimeWrite( int debounceTime_ms )
+{
+    if ( debounceTime_ms < DEBOUNCE_KEY_TIME_MIN_MS ||
+         debounceTime_ms > DEBOUNCE_KEY_TIME_MAX_MS ) {
+        return false;
+    }
+    debounceKeyTime_ms = debounceTime_ms;
+    return true;
 }
 
 //=====[Implementations of private functions]==================================
 
-static char matrixKeypadScan()
+// Three port writes and two port reads per row. Several keys can be down
+// at once; without diodes three keys on the corners of a rectangle also
+// show the fourth.
+static uint16_t matrixKeypadScan()
 {
+    uint16_t bitmap = 0;
     int row = 0;
-    int col = 0;
-    int i = 0; 
-
-    char matrixKeypadIndexToCharArray[] = {
-        '1', '2', '3', 'A',
-        '4', '5', '6', 'B',
-        '7', '8', '9', 'C',
-        '*', '0', '#', 'D',
-    };
-//recorro los rows 
+
     for( row=0; row<MATRIX_KEYPAD_NUMBER_OF_ROWS; row++ ) {
-        //clear
-        for( i=0; i<MATRIX_KEYPAD_NUMBER_OF_ROWS; i++ ) {
-            keypadRowPins[i] = ON;
-        }
+        keypadRowsPortA = matrixKeypadRowPatterns[row].portA;
+        keypadRowsPortB = matrixKeypadRowPatterns[row].portB;
+        keypadRowsPortC = matrixKeypadRowPatterns[row].portC;
+        bitmap |= matrixKeypadColumnsRead() <<
+                  ( row * MATRIX_KEYPAD_NUMBER_OF_COLS );
+    }
+    return bitmap;
+}
 
-        keypadRowPins[row] = OFF;
+// One bit per column, set for a column pulled low by a pressed key
+static int matrixKeypadColumnsRead()
+{
+    int portB = keypadColsPortB.read();
+    int portC = keypadColsPortC.read();
+    int released = ( ( portB >> 12 ) & 0x1 ) |
+                   ( ( portB >> 10 ) & 0x1 ) << 1 |
+                   ( ( portB >> 15 ) & 0x1 ) << 2 |
+                   ( ( portC >> 6 ) & 0x1 ) << 3;
+    return ~released & 0xF;
+}
 
-        for( col=0; col<MATRIX_KEYPAD_NUMBER_OF_COLS; col++ ) {
-            if( keypadColPins[col] == OFF ) {
-                return matrixKeypadIndexToCharArray[
-                    row*MATRIX_KEYPAD_NUMBER_OF_ROWS + col];
-            }
+static void matrixKeypadDebounce( uint16_t rawBitmap )
+{
+    uint16_t changed = rawBitmap ^ keypadStableBitmap;
+    int keyIndex = 0;
+
+    for( keyIndex=0; keyIndex<MATRIX_KEYPAD_NUMBER_OF_KEYS; keyIndex++ ) {
+        if( !( changed & ( 1 << keyIndex ) ) ) {
+            keypadDebounceTime_ms[keyIndex] = 0;
+            continue;
+        }
+        keypadDebounceTime_ms[keyIndex] += timeIncrement_ms;
+        if( keypadDebounceTime_ms[keyIndex] >= debounceKeyTime_ms ) {
+            keypadStableBitmap ^= ( 1 << keyIndex );
+            keypadDebounceTime_ms[keyIndex] = 0;
+            matrixKeypadEventWrite( keyIndex,
+                                    rawBitmap & ( 1 << keyIndex ) );
         }
     }
-    return '\0';
 }
 
-static void matrixKeypadReset()
+// When the queue is full the new event is dropped and counted
+static void matrixKeypadEventWrite( int keyIndex, bool pressed )
 {
+    matrixKeypadEvent_t event;
+
+    event.key = matrixKeypadIndexToCharArray[keyIndex];
+    event.pressed = pressed;
+    event.time_us = dateAndTimeMonotonicRead();
+    TRACE_BUFFER_WRITE( TRACE_EVENT_KEYPAD_KEY, event.key << 8 | pressed );
+    if ( pressed ) {
+        metricsCounterIncrement( METRICS_COUNTER_KEYPAD_PRESSES );
+    }
+    if ( !keypadEvents.push( event ) ) {
+        keypadDroppedEvents++;
+        metricsCounterIncrement( METRICS_COUNTER_KEYPAD_DROPPED_EVENTS );
+    }
+}
+
+// All rows low, so that any key pulls its column down and interrupts
+static void matrixKeypadIdleEnter()
+{
+    int i = 0;
+
+    keypadRowsPortA = 0;
+    keypadRowsPortB = 0;
+    keypadRowsPortC = 0;
+    keypadWakeUp = false;
+    matrixKeypadState = MATRIX_KEYPAD_IDLE;
+    TRACE_BUFFER_WRITE( TRACE_EVENT_KEYPAD_SCAN_END, 0 );
+    for( i=0; i<MATRIX_KEYPAD_NUMBER_OF_COLS; i++ ) {
+        keypadColPins[i]->enable_irq();
+    }
+    // A key already held down when the interrupts are armed gives no edge
+    if( matrixKeypadColumnsRead() != 0 ) {
+        keypadWakeUp = true;
+    }
+}
+
+// Scanning toggles the rows, which would make the columns interrupt
+static void matrixKeypadIdleExit()
+{
+    int i = 0;
+
+    for( i=0; i<MATRIX_KEYPAD_NUMBER_OF_COLS; i++ ) {
+        keypadColPins[i]->disable_irq();
+    }
     matrixKeypadState = MATRIX_KEYPAD_SCANNING;
+    TRACE_BUFFER_WRITE( TRACE_EVENT_KEYPAD_SCAN_BEGIN, 0 );
+}
+
+static void matrixKeypadWakeUpIsr()
+{
+    int i = 0;
+
+    for( i=0; i<MATRIX_KEYPAD_NUMBER_OF_COLS; i++ ) {
+        keypadColPins[i]->disable_irq();
+    }
+    keypadWakeUp = true;
+    powerManagerWakeUp();
 }
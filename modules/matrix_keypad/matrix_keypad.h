@@ -3,15 +3,37 @@
 #ifndef _MATRIX_KEYPAD_H_
 #define _MATRIX_KEYPAD_H_
 
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
 //=====[Declaration of public defines]=========================================
 
+#define DEBOUNCE_KEY_TIME_MS        40
+#define DEBOUNCE_KEY_TIME_MIN_MS    10
+#define DEBOUNCE_KEY_TIME_MAX_MS   500
+
+// A power of two
+#define MATRIX_KEYPAD_EVENT_QUEUE_SIZE    16
+
 //=====[Declaration of public data types]======================================
 
+typedef struct matrixKeypadEvent {
+    char key;
+    bool pressed;
+    uint64_t time_us;
+} matrixKeypadEvent_t;
+
 //=====[Declarations (prototypes) of public functions]=========================
 
 void matrixKeypadInit( int updateTime_ms );
-char matrixKeypadUpdate();
+void matrixKeypadUpdate();
+bool matrixKeypadEventRead( matrixKeypadEvent_t* event );
+uint16_t matrixKeypadBitmapRead();
+uint32_t matrixKeypadDroppedEventsRead();
+bool matrixKeypadDebounceTimeWrite( int debounceTime_ms );
+bool matrixKeypadIdleRead();
 
 //=====[#include guards - end]=================================================
 
-#endif // _MATRIX_KEYPAD_H_
\ No newline at end of file
+#endif // _MATRIX_KEYPAD_H_
@@ -0,0 +1,183 @@
+//=====[Libraries]=============================================================
+
+#include "metrics.h"
+
+#include "text_format.h"
+
+//=====[Declaration of private defines]========================================
+
+//=====[Declaration of private data types]=====================================
+
+// A value falls in the first bucket whose upper bound it does not exceed;
+// the last bucket takes everything above the last bound
+typedef struct metricsHistogramInfo {
+    const char* name;
+    uint32_t upperBounds[METRICS_HISTOGRAM_NUMBER_OF_BUCKETS - 1];
+} metricsHistogramInfo_t;
+
+//=====[Declaration and initialization of public global objects]===============
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+std::atomic<uint32_t> metricsCounters[METRICS_NUMBER_OF_COUNTERS];
+std::atomic<int32_t> metricsGauges[METRICS_NUMBER_OF_GAUGES];
+std::atomic<uint32_t>
+    metricsHistogramBuckets[METRICS_NUMBER_OF_HISTOGRAMS]
+                           [METRICS_HISTOGRAM_NUMBER_OF_BUCKETS];
+
+//=====[Declaration and initialization of private global variables]============
+
+static const char* const metricsCounterNames[METRICS_NUMBER_OF_COUNTERS] = {
+    "alarmTripsGas",
+    "alarmTripsOverTemp",
+    "alarmTripsTest",
+    "alarmTime_ms",
+    "incorrectCodes",
+    "systemBlocks",
+    "keypadPresses",
+    "keypadDroppedEvents",
+    "serialRxBytes",
+    "serialTxBytes",
+    "serialRxDroppedBytes",
+    "serialTxDroppedBytes",
+    "loopOverruns",
+    "telemetryDroppedBatches",
+    "sirenChanges",
+    "strobeLightChanges",
+    "incorrectCodeLedChanges",
+    "systemBlockedLedChanges",
+    "outputPortWrites",
+    "outputCommits",
+};
+
+static const char* const metricsGaugeNames[METRICS_NUMBER_OF_GAUGES] = {
+    "temperature_dC",
+    "maxLoopTime_us",
+};
+
+static const metricsHistogramInfo_t
+    metricsHistograms[METRICS_NUMBER_OF_HISTOGRAMS] = {
+    { "loopTime_us",    { 500, 1000, 2000, 5000, 10000 } },
+    { "standbyTime_ms", { 10, 50, 100, 500, 1000 } },
+};
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static char* metricsHistogramTextWrite( char* str, int histogram );
+static char* metricsHistogramJsonWrite( char* str, int histogram );
+
+//=====[Implementations of public functions]===================================
+
+// Safe from any thread or interrupt, like the counters
+void metricsHistogramRecord( metricsHistogram_t histogram, uint32_t value )
+{
+    const uint32_t* upperBounds = metricsHistograms[histogram].upperBounds;
+    int bucket = 0;
+
+    while ( bucket < METRICS_HISTOGRAM_NUMBER_OF_BUCKETS - 1 &&
+            value > upperBounds[bucket] ) {
+        bucket++;
+    }
+    metricsHistogramBuckets[histogram][bucket].fetch_add(
+        1, std::memory_order_relaxed );
+}
+
+// metric runs over the counters, then the gauges, then the histograms.
+// Writes one line, such as "keypadPresses: 12\r\n".
+char* metricsTextWrite( char* str, int metric )
+{
+    if ( metric < METRICS_NUMBER_OF_COUNTERS ) {
+        str = textFormatString( str, metricsCounterNames[metric] );
+        str = textFormatString( str, ": " );
+        str = textFormatUnsigned( str,
+                  metricsCounterRead( (metricsCounter_t)metric ) );
+    } else if ( metric < METRICS_NUMBER_OF_COUNTERS + METRICS_NUMBER_OF_GAUGES ) {
+        metric -= METRICS_NUMBER_OF_COUNTERS;
+        str = textFormatString( str, metricsGaugeNames[metric] );
+        str = textFormatString( str, ": " );
+        str = textFormatInt( str, metricsGaugeRead( (metricsGauge_t)metric ) );
+    } else {
+        str = metricsHistogramTextWrite( str, metric -
+                  METRICS_NUMBER_OF_COUNTERS - METRICS_NUMBER_OF_GAUGES );
+    }
+    return textFormatString( str, "\r\n" );
+}
+
+// The same metric as a JSON member: "keypadPresses":12 for counters and
+// gauges, "loopTime_us":{"le":[500,...],"counts":[3,...]} for histograms,
+// where counts has one more entry than le for the values above the last
+// bound
+char* metricsJsonWrite( char* str, int metric )
+{
+    if ( metric < METRICS_NUMBER_OF_COUNTERS ) {
+        str = textFormatString( str, "\"" );
+        str = textFormatString( str, metricsCounterNames[metric] );
+        str = textFormatString( str, "\":" );
+        return textFormatUnsigned( str,
+                   metricsCounterRead( (metricsCounter_t)metric ) );
+    } else if ( metric < METRICS_NUMBER_OF_COUNTERS + METRICS_NUMBER_OF_GAUGES ) {
+        metric -= METRICS_NUMBER_OF_COUNTERS;
+        str = textFormatString( str, "\"" );
+        str = textFormatString( str, metricsGaugeNames[metric] );
+        str = textFormatString( str, "\":" );
+        return textFormatInt( str, metricsGaugeRead( (metricsGauge_t)metric ) );
+    } else {
+        return metricsHistogramJsonWrite( str, metric -
+                   METRICS_NUMBER_OF_COUNTERS - METRICS_NUMBER_OF_GAUGES );
+    }
+}
+
+//=====[Implementations of private functions]==================================
+
+// loopTime_us: <=500: 3, <=1000: 0, ..., >10000: 0
+static char* metricsHistogramTextWrite( char* str, int histogram )
+{
+    const metricsHistogramInfo_t* info = &metricsHistograms[histogram];
+    int bucket;
+
+    str = textFormatString( str, info->name );
+    str = textFormatString( str, ":" );
+    for ( bucket = 0; bucket < METRICS_HISTOGRAM_NUMBER_OF_BUCKETS; bucket++ ) {
+        if ( bucket < METRICS_HISTOGRAM_NUMBER_OF_BUCKETS - 1 ) {
+            str = textFormatString( str, bucket == 0 ? " <=" : ", <=" );
+            str = textFormatUnsigned( str, info->upperBounds[bucket] );
+        } else {
+            str = textFormatString( str, ", >" );
+            str = textFormatUnsigned( str, info->upperBounds[bucket - 1] );
+        }
+        str = textFormatString( str, ": " );
+        str = textFormatUnsigned( str,
+                  metricsHistogramBuckets[histogram][bucket].load(
+                      std::memory_order_relaxed ) );
+    }
+    return str;
+}
+
+static char* metricsHistogramJsonWrite( char* str, int histogram )
+{
+    const metricsHistogramInfo_t* info = &metricsHistograms[histogram];
+    int bucket;
+
+    str = textFormatString( str, "\"" );
+    str = textFormatString( str, info->name );
+    str = textFormatString( str, "\":{\"le\":[" );
+    for ( bucket = 0; bucket < METRICS_HISTOGRAM_NUMBER_OF_BUCKETS - 1;
+          bucket++ ) {
+        if ( bucket > 0 ) {
+            str = textFormatString( str, "," );
+        }
+        str = textFormatUnsigned( str, info->upperBounds[bucket] );
+    }
+    str = textFormatString( str, "],\"counts\":[" );
+    for ( bucket = 0; bucket < METRICS_HISTOGRAM_NUMBER_OF_BUCKETS; bucket++ ) {
+        if ( bucket > 0 ) {
+            str = textFormatString( str, "," );
+        }
+        str = textFormatUnsigned( str,
+                  metricsHistogramBuckets[histogram][bucket].load(
+                      std::memory_order_relaxed ) );
+    }
+    return textFormatString( str, "]}" );
+}
@@ -0,0 +1,111 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include <atomic>
+
+//=====[Declaration of public defines]=========================================
+
+#define METRICS_HISTOGRAM_NUMBER_OF_BUCKETS    6
+
+// Fits the longest line of metricsTextWrite() and member of
+// metricsJsonWrite()
+#define METRICS_STR_LENGTH    160
+
+#define METRICS_NUMBER_OF_METRICS    ( METRICS_NUMBER_OF_COUNTERS + \
+                                       METRICS_NUMBER_OF_GAUGES + \
+                                       METRICS_NUMBER_OF_HISTOGRAMS )
+
+//=====[Declaration of public data types]======================================
+
+// Keep in step with the name tables in metrics.cpp
+typedef enum {
+    METRICS_COUNTER_ALARM_TRIPS_GAS,
+    METRICS_COUNTER_ALARM_TRIPS_OVER_TEMP,
+    METRICS_COUNTER_ALARM_TRIPS_TEST,
+    METRICS_COUNTER_ALARM_TIME_MS,
+    METRICS_COUNTER_INCORRECT_CODES,
+    METRICS_COUNTER_SYSTEM_BLOCKS,
+    METRICS_COUNTER_KEYPAD_PRESSES,
+    METRICS_COUNTER_KEYPAD_DROPPED_EVENTS,
+    METRICS_COUNTER_SERIAL_RX_BYTES,
+    METRICS_COUNTER_SERIAL_TX_BYTES,
+    METRICS_COUNTER_SERIAL_RX_DROPPED_BYTES,
+    METRICS_COUNTER_SERIAL_TX_DROPPED_BYTES,
+    METRICS_COUNTER_LOOP_OVERRUNS,
+    METRICS_COUNTER_TELEMETRY_DROPPED_BATCHES,
+    // One per output, in outputManagerOutput_t order
+    METRICS_COUNTER_SIREN_CHANGES,
+    METRICS_COUNTER_STROBE_LIGHT_CHANGES,
+    METRICS_COUNTER_INCORRECT_CODE_LED_CHANGES,
+    METRICS_COUNTER_SYSTEM_BLOCKED_LED_CHANGES,
+    METRICS_COUNTER_OUTPUT_PORT_WRITES,
+    METRICS_COUNTER_OUTPUT_COMMITS,
+    METRICS_NUMBER_OF_COUNTERS,
+} metricsCounter_t;
+
+typedef enum {
+    METRICS_GAUGE_TEMPERATURE_DC,
+    METRICS_GAUGE_MAX_LOOP_TIME_US,
+    METRICS_NUMBER_OF_GAUGES,
+} metricsGauge_t;
+
+typedef enum {
+    METRICS_HISTOGRAM_LOOP_TIME_US,
+    METRICS_HISTOGRAM_STANDBY_TIME_MS,
+    METRICS_NUMBER_OF_HISTOGRAMS,
+} metricsHistogram_t;
+
+//=====[Declaration of external public global variables]=======================
+
+extern std::atomic<uint32_t> metricsCounters[METRICS_NUMBER_OF_COUNTERS];
+extern std::atomic<int32_t> metricsGauges[METRICS_NUMBER_OF_GAUGES];
+extern std::atomic<uint32_t>
+    metricsHistogramBuckets[METRICS_NUMBER_OF_HISTOGRAMS]
+                           [METRICS_HISTOGRAM_NUMBER_OF_BUCKETS];
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void metricsHistogramRecord( metricsHistogram_t histogram, uint32_t value );
+char* metricsTextWrite( char* str, int metric );
+char* metricsJsonWrite( char* str, int metric );
+
+//=====[Implementations of public inline functions]============================
+
+// Safe from any thread or interrupt: an increment is a single exclusive
+// load/store loop, so the metrics can stay enabled in production builds.
+// They wrap around at 2^32.
+static inline void metricsCounterAdd( metricsCounter_t counter,
+                                      uint32_t value )
+{
+    metricsCounters[counter].fetch_add( value, std::memory_order_relaxed );
+}
+
+static inline void metricsCounterIncrement( metricsCounter_t counter )
+{
+    metricsCounterAdd( counter, 1 );
+}
+
+static inline uint32_t metricsCounterRead( metricsCounter_t counter )
+{
+    return metricsCounters[counter].load( std::memory_order_relaxed );
+}
+
+static inline void metricsGaugeWrite( metricsGauge_t gauge, int32_t value )
+{
+    metricsGauges[gauge].store( value, std::memory_order_relaxed );
+}
+
+static inline int32_t metricsGaugeRead( metricsGauge_t gauge )
+{
+    return metricsGauges[gauge].load( std::memory_order_relaxed );
+}
+
+//=====[#include guards - end]=================================================
+
+#endif // _METRICS_H_
@@ -0,0 +1,440 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "modbus_slave.h"
+
+#include "fire_alarm.h"
+#include "code.h"
+#include "event_log.h"
+#include "power_manager.h"
+
+//=====[Declaration of private defines]========================================
+
+#define MODBUS_SLAVE_ADDRESS               1
+#define MODBUS_SLAVE_BROADCAST_ADDRESS     0
+#define MODBUS_SLAVE_BAUD_RATE         19200
+// UART7 rather than USART6 on PG_14/PG_9: PG_9 shares EXTI line 9 with
+// the USB console's RX, and both RX pins must be able to wake the panel
+#define MODBUS_SLAVE_TX                 PE_8
+#define MODBUS_SLAVE_RX                 PE_7
+#define MODBUS_SLAVE_DE                PG_12
+
+#define MODBUS_SLAVE_FRAME_MAX_LENGTH    256
+#define MODBUS_SLAVE_REQUEST_LENGTH        8
+#define MODBUS_SLAVE_MAX_READ_REGISTERS  125
+
+// 11 bits per character (start, 8 data, parity, stop). Above 19200 baud
+// the standard fixes the end-of-frame silence at 1750 us.
+#define MODBUS_SLAVE_CHAR_TIME_US    (11 * 1000000 / MODBUS_SLAVE_BAUD_RATE)
+#define MODBUS_SLAVE_T35_US          (MODBUS_SLAVE_BAUD_RATE > 19200 ? 1750 : \
+                                      35 * MODBUS_SLAVE_CHAR_TIME_US / 10)
+
+#define MODBUS_FC_READ_COILS               0x01
+#define MODBUS_FC_READ_DISCRETE_INPUTS     0x02
+#define MODBUS_FC_READ_HOLDING_REGISTERS   0x03
+#define MODBUS_FC_READ_INPUT_REGISTERS     0x04
+#define MODBUS_FC_WRITE_SINGLE_COIL        0x05
+
+#define MODBUS_EXCEPTION_ILLEGAL_FUNCTION      0x01
+#define MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS  0x02
+#define MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE    0x03
+
+//=====[Declaration of private data types]=====================================
+
+// Copy of the panel state the interrupts answer from
+typedef struct modbusSlaveImage {
+    uint16_t registers[MODBUS_SLAVE_NUMBER_OF_REGISTERS];
+    uint16_t inputs;
+} modbusSlaveImage_t;
+
+//=====[Declaration and initialization of public global objects]===============
+
+UnbufferedSerial modbusUart(MODBUS_SLAVE_TX, MODBUS_SLAVE_RX,
+                            MODBUS_SLAVE_BAUD_RATE);
+DigitalOut modbusDriverEnable(MODBUS_SLAVE_DE);
+// Wakes the panel in standby, when the UART stops
+InterruptIn modbusRxWakeUp(MODBUS_SLAVE_RX);
+Timeout modbusFrameTimeout;
+Timeout modbusTurnaroundTimeout;
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+//=====[Declaration and initialization of private global variables]============
+
+static uint8_t rxFrame[MODBUS_SLAVE_FRAME_MAX_LENGTH];
+static volatile int rxFrameLength = 0;
+static volatile bool rxFrameOverrun = false;
+
+static uint8_t txFrame[MODBUS_SLAVE_FRAME_MAX_LENGTH];
+static volatile int txFrameLength = 0;
+static volatile int txFrameIndex = 0;
+static volatile bool transmitting = false;
+
+static modbusSlaveImage_t modbusImage;
+static volatile bool coilRequests[MODBUS_SLAVE_NUMBER_OF_COILS];
+static modbusSlaveStats_t modbusStats = { 0, 0, 0, 0 };
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void modbusSlaveRxIsr();
+static void modbusSlaveFrameEndIsr();
+static void modbusSlaveTxIsr();
+static void modbusSlaveTurnaroundIsr();
+
+static void modbusSlaveFrameProcess();
+static int modbusSlaveReadBits( const uint8_t* request, int numberOfBits,
+                                bool (*bitRead)( int address ) );
+static int modbusSlaveReadRegisters( const uint8_t* request );
+static int modbusSlaveWriteSingleCoil( const uint8_t* request );
+static bool modbusSlaveInputRead( int address );
+static bool modbusSlaveCoilRead( int address );
+static void modbusSlaveImageUpdate();
+static uint16_t modbusSlaveTemperatureRegister( float temperatureC );
+
+static uint16_t modbusSlaveCrc( const uint8_t* data, int length );
+static uint16_t modbusSlaveWordRead( const uint8_t* data );
+
+//=====[Implementations of public functions]===================================
+
+void modbusSlaveInit()
+{
+    modbusDriverEnable = OFF;
+    modbusUart.format( 8, SerialBase::Even, 1 );
+    modbusSlaveImageUpdate();
+    modbusUart.attach( &modbusSlaveRxIsr, SerialBase::RxIrq );
+    // InterruptIn made the RX pin a plain input; it goes back to the UART
+    pinmap_pinout( MODBUS_SLAVE_RX, serial_rx_pinmap() );
+    modbusRxWakeUp.fall( &powerManagerWakeUp );
+    modbusRxWakeUp.disable_irq();
+}
+
+// Polls are answered from interrupt context as soon as a frame ends; the
+// main loop only refreshes the register image and carries out coil writes
+void modbusSlaveUpdate()
+{
+    if ( coilRequests[MODBUS_SLAVE_COIL_ACKNOWLEDGE] ) {
+        fireAlarmRemoteDeactivate();
+        coilRequests[MODBUS_SLAVE_COIL_ACKNOWLEDGE] = false;
+    }
+    if ( coilRequests[MODBUS_SLAVE_COIL_LOCKOUT_RESET] ) {
+        codeLockoutReset();
+        coilRequests[MODBUS_SLAVE_COIL_LOCKOUT_RESET] = false;
+    }
+    modbusSlaveImageUpdate();
+}
+
+void modbusSlaveStatsRead( modbusSlaveStats_t* stats )
+{
+    *stats = modbusStats;
+}
+
+// True between frames, when neither a request nor an answer is on the bus
+bool modbusSlaveIdleRead()
+{
+    return rxFrameLength == 0 && !transmitting;
+}
+
+// The UART lets go of its deep sleep lock for a standby and the RX pin
+// wakes the panel instead. The request that wakes it loses its first
+// characters while the clocks restart, fails its CRC and is not answered;
+// the master's retry is, as the panel stays awake for a while after.
+void modbusSlaveStandbyEnter()
+{
+    modbusRxWakeUp.enable_irq();
+    modbusUart.attach( nullptr, SerialBase::RxIrq );
+}
+
+void modbusSlaveStandbyExit()
+{
+    modbusUart.attach( &modbusSlaveRxIsr, SerialBase::RxIrq );
+    modbusRxWakeUp.disable_irq();
+}
+
+//=====[Implementations of private functions]==================================
+
+// Every character restarts the t3.5 timer; the frame ends when it expires.
+// Characters seen while we drive the bus are our own echo.
+static void modbusSlaveRxIsr()
+{
+    uint8_t receivedByte;
+    while ( modbusUart.readable() ) {
+        modbusUart.read( &receivedByte, 1 );
+        if ( transmitting ) {
+            continue;
+        }
+        if ( rxFrameLength < MODBUS_SLAVE_FRAME_MAX_LENGTH ) {
+            rxFrame[rxFrameLength] = receivedByte;
+            rxFrameLength++;
+        } else {
+            rxFrameOverrun = true;
+        }
+    }
+    if ( !transmitting ) {
+        modbusFrameTimeout.attach( &modbusSlaveFrameEndIsr,
+                                   std::chrono::microseconds( MODBUS_SLAVE_T35_US ) );
+    }
+}
+
+// The answer goes out from here; the superloop is woken to carry out coil
+// writes and refresh the image for the next poll
+static void modbusSlaveFrameEndIsr()
+{
+    modbusSlaveFrameProcess();
+    rxFrameLength = 0;
+    rxFrameOverrun = false;
+    powerManagerWakeUp();
+}
+
+static void modbusSlaveTxIsr()
+{
+    while ( txFrameIndex < txFrameLength && modbusUart.writeable() ) {
+        modbusUart.write( &txFrame[txFrameIndex], 1 );
+        txFrameIndex++;
+    }
+    if ( txFrameIndex >= txFrameLength ) {
+        modbusUart.attach( nullptr, SerialBase::TxIrq );
+        // The last two characters may still be in the shift registers
+        modbusTurnaroundTimeout.attach( &modbusSlaveTurnaroundIsr,
+            std::chrono::microseconds( 2 * MODBUS_SLAVE_CHAR_TIME_US ) );
+    }
+}
+
+static void modbusSlaveTurnaroundIsr()
+{
+    modbusDriverEnable = OFF;
+    transmitting = false;
+}
+
+static void modbusSlaveFrameProcess()
+{
+    const uint8_t* request = rxFrame;
+    int responseLength = 0;
+    uint8_t exception = 0;
+    uint16_t crc;
+
+    if ( rxFrameOverrun || rxFrameLength < 4 || transmitting ) {
+        modbusStats.frameErrors++;
+        return;
+    }
+    crc = modbusSlaveCrc( rxFrame, rxFrameLength - 2 );
+    if ( rxFrame[rxFrameLength - 2] != ( crc & 0xFF ) ||
+         rxFrame[rxFrameLength - 1] != ( crc >> 8 ) ) {
+        modbusStats.frameErrors++;
+        return;
+    }
+    if ( request[0] != MODBUS_SLAVE_ADDRESS &&
+         request[0] != MODBUS_SLAVE_BROADCAST_ADDRESS ) {
+        return;
+    }
+    modbusStats.framesReceived++;
+
+    if ( rxFrameLength != MODBUS_SLAVE_REQUEST_LENGTH ) {
+        exception = MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    } else {
+        switch ( request[1] ) {
+            case MODBUS_FC_READ_COILS:
+                responseLength = modbusSlaveReadBits( request,
+                                     MODBUS_SLAVE_NUMBER_OF_COILS,
+                                     &modbusSlaveCoilRead );
+            break;
+            case MODBUS_FC_READ_DISCRETE_INPUTS:
+                responseLength = modbusSlaveReadBits( request,
+                                     MODBUS_SLAVE_NUMBER_OF_INPUTS,
+                                     &modbusSlaveInputRead );
+            break;
+            case MODBUS_FC_READ_HOLDING_REGISTERS:
+            case MODBUS_FC_READ_INPUT_REGISTERS:
+                responseLength = modbusSlaveReadRegisters( request );
+            break;
+            case MODBUS_FC_WRITE_SINGLE_COIL:
+                responseLength = modbusSlaveWriteSingleCoil( request );
+            break;
+            default:
+                responseLength = -MODBUS_EXCEPTION_ILLEGAL_FUNCTION;
+            break;
+        }
+        if ( responseLength < 0 ) {
+            exception = (uint8_t)( -responseLength );
+        }
+    }
+
+    if ( request[0] == MODBUS_SLAVE_BROADCAST_ADDRESS ) {
+        return;
+    }
+
+    txFrame[0] = MODBUS_SLAVE_ADDRESS;
+    if ( exception != 0 ) {
+        txFrame[1] = request[1] | 0x80;
+        txFrame[2] = exception;
+        responseLength = 3;
+        modbusStats.exceptions++;
+    } else {
+        txFrame[1] = request[1];
+    }
+    crc = modbusSlaveCrc( txFrame, responseLength );
+    txFrame[responseLength] = crc & 0xFF;
+    txFrame[responseLength + 1] = crc >> 8;
+    txFrameLength = responseLength + 2;
+    txFrameIndex = 0;
+    modbusStats.responses++;
+
+    transmitting = true;
+    modbusDriverEnable = ON;
+    modbusUart.attach( &modbusSlaveTxIsr, SerialBase::TxIrq );
+}
+
+// Each handler fills txFrame from byte 2 on and returns the response length
+// without CRC, or a negated exception code
+static int modbusSlaveReadBits( const uint8_t* request, int numberOfBits,
+                                bool (*bitRead)( int address ) )
+{
+    int start = modbusSlaveWordRead( &request[2] );
+    int quantity = modbusSlaveWordRead( &request[4] );
+    int numberOfBytes = ( quantity + 7 ) / 8;
+    int i;
+
+    if ( quantity < 1 || quantity > numberOfBits ) {
+        return -MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    if ( start + quantity > numberOfBits ) {
+        return -MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
+    txFrame[2] = numberOfBytes;
+    memset( &txFrame[3], 0, numberOfBytes );
+    for ( i = 0; i < quantity; i++ ) {
+        if ( bitRead( start + i ) ) {
+            txFrame[3 + i / 8] |= 1 << ( i % 8 );
+        }
+    }
+    return 3 + numberOfBytes;
+}
+
+static int modbusSlaveReadRegisters( const uint8_t* request )
+{
+    int start = modbusSlaveWordRead( &request[2] );
+    int quantity = modbusSlaveWordRead( &request[4] );
+    int i;
+
+    if ( quantity < 1 || quantity > MODBUS_SLAVE_MAX_READ_REGISTERS ) {
+        return -MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    if ( start + quantity > MODBUS_SLAVE_NUMBER_OF_REGISTERS ) {
+        return -MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
+    txFrame[2] = 2 * quantity;
+    for ( i = 0; i < quantity; i++ ) {
+        txFrame[3 + 2 * i] = modbusImage.registers[start + i] >> 8;
+        txFrame[4 + 2 * i] = modbusImage.registers[start + i] & 0xFF;
+    }
+    return 3 + 2 * quantity;
+}
+
+// The response to a single coil write echoes the request
+static int modbusSlaveWriteSingleCoil( const uint8_t* request )
+{
+    int address = modbusSlaveWordRead( &request[2] );
+    int value = modbusSlaveWordRead( &request[4] );
+
+    if ( value != 0xFF00 && value != 0x0000 ) {
+        return -MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    if ( address >= MODBUS_SLAVE_NUMBER_OF_COILS ) {
+        return -MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
+    if ( value == 0xFF00 ) {
+        coilRequests[address] = true;
+    }
+    memcpy( &txFrame[2], &request[2], 4 );
+    return 6;
+}
+
+static bool modbusSlaveInputRead( int address )
+{
+    return ( modbusImage.inputs >> address ) & 1;
+}
+
+static bool modbusSlaveCoilRead( int address )
+{
+    return coilRequests[address];
+}
+
+// Built outside the critical section, copied inside it so the interrupts
+// never see a half-updated image
+static void modbusSlaveImageUpdate()
+{
+    modbusSlaveImage_t image;
+    fireAlarmSnapshot_t snapshot;
+
+    fireAlarmSnapshotRead( &snapshot );
+    image.registers[MODBUS_SLAVE_REG_ALARM_STATE] = snapshot.alarm;
+    image.registers[MODBUS_SLAVE_REG_ALARM_CAUSE] = snapshot.cause;
+    image.registers[MODBUS_SLAVE_REG_GAS_DETECTOR] = snapshot.gasDetector;
+    image.registers[MODBUS_SLAVE_REG_OVER_TEMP_DETECTOR] =
+        snapshot.overTemperatureDetector;
+    image.registers[MODBUS_SLAVE_REG_TEMPERATURE_C_X100] =
+        modbusSlaveTemperatureRegister( snapshot.temperatureC );
+    image.registers[MODBUS_SLAVE_REG_INCORRECT_CODE] = snapshot.incorrectCode;
+    image.registers[MODBUS_SLAVE_REG_SYSTEM_BLOCKED] = snapshot.systemBlocked;
+    image.registers[MODBUS_SLAVE_REG_LOGGED_EVENTS] =
+        (uint16_t)eventLogNumberOfLoggedEventsRead();
+    image.registers[MODBUS_SLAVE_REG_FRAMES_RECEIVED] =
+        (uint16_t)modbusStats.framesReceived;
+    image.registers[MODBUS_SLAVE_REG_FRAME_ERRORS] =
+        (uint16_t)modbusStats.frameErrors;
+
+    image.inputs = ( snapshot.alarm << MODBUS_SLAVE_INPUT_ALARM_STATE ) |
+        ( snapshot.gasDetected << MODBUS_SLAVE_INPUT_GAS_DETECTED ) |
+        ( snapshot.overTemperatureDetected << MODBUS_SLAVE_INPUT_OVER_TEMP_DETECTED ) |
+        ( snapshot.gasDetector << MODBUS_SLAVE_INPUT_GAS_DETECTOR ) |
+        ( snapshot.overTemperatureDetector << MODBUS_SLAVE_INPUT_OVER_TEMP_DETECTOR ) |
+        ( snapshot.incorrectCode << MODBUS_SLAVE_INPUT_INCORRECT_CODE ) |
+        ( snapshot.systemBlocked << MODBUS_SLAVE_INPUT_SYSTEM_BLOCKED );
+
+    core_util_critical_section_enter();
+    modbusImage = image;
+    core_util_critical_section_exit();
+}
+
+// Signed hundredths of a degree, saturated to what 16 bits hold: a full
+// scale LM35 reading (330 C) does not fit
+static uint16_t modbusSlaveTemperatureRegister( float temperatureC )
+{
+    float scaled = temperatureC * 100.0f;
+
+    if ( scaled >= (float)INT16_MAX ) {
+        return (uint16_t)INT16_MAX;
+    }
+    if ( scaled <= (float)INT16_MIN ) {
+        return (uint16_t)INT16_MIN;
+    }
+    return (uint16_t)(int16_t)scaled;
+}
+
+// CRC-16/MODBUS: reflected polynomial 0xA001, initial value 0xFFFF
+static uint16_t modbusSlaveCrc( const uint8_t* data, int length )
+{
+    uint16_t crc = 0xFFFF;
+    int i;
+    int bit;
+
+    for ( i = 0; i < length; i++ ) {
+        crc ^= data[i];
+        for ( bit = 0; bit < 8; bit++ ) {
+            if ( crc & 1 ) {
+                crc = ( crc >> 1 ) ^ 0xA001;
+            } else {
+                crc = crc >> 1;
+            }
+        }
+    }
+    return crc;
+}
+
+static uint16_t modbusSlaveWordRead( const uint8_t* data )
+{
+    return ( data[0] << 8 ) | data[1];
+}
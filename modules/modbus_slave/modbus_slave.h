@@ -0,0 +1,63 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _MODBUS_SLAVE_H_
+#define _MODBUS_SLAVE_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+// Register map, served both as input registers (FC04) and as read-only
+// holding registers (FC03). The counters are the low 16 bits of counts
+// kept since reset
+#define MODBUS_SLAVE_REG_ALARM_STATE          0
+#define MODBUS_SLAVE_REG_ALARM_CAUSE          1
+#define MODBUS_SLAVE_REG_GAS_DETECTOR         2
+#define MODBUS_SLAVE_REG_OVER_TEMP_DETECTOR   3
+#define MODBUS_SLAVE_REG_TEMPERATURE_C_X100   4
+#define MODBUS_SLAVE_REG_INCORRECT_CODE       5
+#define MODBUS_SLAVE_REG_SYSTEM_BLOCKED       6
+#define MODBUS_SLAVE_REG_LOGGED_EVENTS        7
+#define MODBUS_SLAVE_REG_FRAMES_RECEIVED      8
+#define MODBUS_SLAVE_REG_FRAME_ERRORS         9
+#define MODBUS_SLAVE_NUMBER_OF_REGISTERS     10
+
+// Discrete inputs (FC02)
+#define MODBUS_SLAVE_INPUT_ALARM_STATE         0
+#define MODBUS_SLAVE_INPUT_GAS_DETECTED        1
+#define MODBUS_SLAVE_INPUT_OVER_TEMP_DETECTED  2
+#define MODBUS_SLAVE_INPUT_GAS_DETECTOR        3
+#define MODBUS_SLAVE_INPUT_OVER_TEMP_DETECTOR  4
+#define MODBUS_SLAVE_INPUT_INCORRECT_CODE      5
+#define MODBUS_SLAVE_INPUT_SYSTEM_BLOCKED      6
+#define MODBUS_SLAVE_NUMBER_OF_INPUTS          7
+
+// Coils (FC01/FC05), momentary: writing ON requests the action and the
+// coil reads ON until the main loop has carried it out
+#define MODBUS_SLAVE_COIL_ACKNOWLEDGE          0
+#define MODBUS_SLAVE_COIL_LOCKOUT_RESET        1
+#define MODBUS_SLAVE_NUMBER_OF_COILS           2
+
+//=====[Declaration of public data types]======================================
+
+typedef struct modbusSlaveStats {
+    uint32_t framesReceived;
+    uint32_t frameErrors;
+    uint32_t exceptions;
+    uint32_t responses;
+} modbusSlaveStats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void modbusSlaveInit();
+void modbusSlaveUpdate();
+void modbusSlaveStatsRead( modbusSlaveStats_t* stats );
+bool modbusSlaveIdleRead();
+void modbusSlaveStandbyEnter();
+void modbusSlaveStandbyExit();
+
+//=====[#include guards - end]=================================================
+
+#endif // _MODBUS_SLAVE_H_
@@ -0,0 +1,142 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "output_manager.h"
+
+#include "trace_buffer.h"
+#include "metrics.h"
+
+//=====[Declaration of private defines]========================================
+
+// Strobe light LED1 (PB_0), system blocked LED2 (PB_7), incorrect code
+// LED3 (PB_14), siren PE_10
+#define OUTPUT_MANAGER_PORTB_MASK    ((1 << 0) | (1 << 7) | (1 << 14))
+#define OUTPUT_MANAGER_PORTE_MASK    (1 << 10)
+
+//=====[Declaration of private data types]=====================================
+
+typedef enum {
+    OUTPUT_MANAGER_PORT_B,
+    OUTPUT_MANAGER_PORT_E,
+    OUTPUT_MANAGER_NUMBER_OF_PORTS,
+} outputManagerPort_t;
+
+typedef struct outputManagerPin {
+    outputManagerPort_t port;
+    int bit;
+    bool inactiveLevel;
+} outputManagerPin_t;
+
+//=====[Declaration and initialization of public global objects]===============
+
+// Only the masked pins are written; the rest of each port is left alone
+PortOut outputsPortB(PortB, OUTPUT_MANAGER_PORTB_MASK);
+PortOut outputsPortE(PortE, OUTPUT_MANAGER_PORTE_MASK);
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+//=====[Declaration and initialization of private global variables]============
+
+static PortOut* const outputManagerPorts[OUTPUT_MANAGER_NUMBER_OF_PORTS] = {
+    &outputsPortB, &outputsPortE,
+};
+
+static const outputManagerPin_t
+    outputManagerPins[OUTPUT_MANAGER_NUMBER_OF_OUTPUTS] = {
+    { OUTPUT_MANAGER_PORT_E, 10, HIGH },    // the siren is active low
+    { OUTPUT_MANAGER_PORT_B, 0,  LOW },
+    { OUTPUT_MANAGER_PORT_B, 14, LOW },
+    { OUTPUT_MANAGER_PORT_B, 7,  LOW },
+};
+
+// Levels the modules asked for, and levels last written to the pins
+static int desiredLevels[OUTPUT_MANAGER_NUMBER_OF_PORTS];
+static int committedLevels[OUTPUT_MANAGER_NUMBER_OF_PORTS];
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void outputManagerChangesCount( outputManagerPort_t port, int changed );
+
+//=====[Implementations of public functions]===================================
+
+// Every output starts at its inactive level, written to the ports at once
+// so that nothing (the siren in particular) is driven while the rest of
+// the system initialises. Set other levels and commit to change that.
+void outputManagerInit()
+{
+    int port;
+    int output;
+
+    for ( port = 0; port < OUTPUT_MANAGER_NUMBER_OF_PORTS; port++ ) {
+        desiredLevels[port] = 0;
+    }
+    for ( output = 0; output < OUTPUT_MANAGER_NUMBER_OF_OUTPUTS; output++ ) {
+        outputManagerWrite( (outputManagerOutput_t)output,
+                            outputManagerPins[output].inactiveLevel );
+    }
+    for ( port = 0; port < OUTPUT_MANAGER_NUMBER_OF_PORTS; port++ ) {
+        committedLevels[port] = desiredLevels[port];
+        *outputManagerPorts[port] = desiredLevels[port];
+    }
+}
+
+// Only the shadow changes; the pin follows at the next commit
+void outputManagerWrite( outputManagerOutput_t output, bool level )
+{
+    const outputManagerPin_t* pin = &outputManagerPins[output];
+
+    if ( level ) {
+        desiredLevels[pin->port] |= ( 1 << pin->bit );
+    } else {
+        desiredLevels[pin->port] &= ~( 1 << pin->bit );
+    }
+}
+
+// The level asked for, which may not have reached the pin yet
+bool outputManagerRead( outputManagerOutput_t output )
+{
+    const outputManagerPin_t* pin = &outputManagerPins[output];
+    return ( desiredLevels[pin->port] >> pin->bit ) & 1;
+}
+
+// Called once per update, after every module has set its outputs. Each
+// port whose shadow differs is written once with all its outputs.
+void outputManagerCommit()
+{
+    int port;
+    int changed;
+
+    metricsCounterIncrement( METRICS_COUNTER_OUTPUT_COMMITS );
+    for ( port = 0; port < OUTPUT_MANAGER_NUMBER_OF_PORTS; port++ ) {
+        changed = desiredLevels[port] ^ committedLevels[port];
+        if ( changed == 0 ) {
+            continue;
+        }
+        *outputManagerPorts[port] = desiredLevels[port];
+        committedLevels[port] = desiredLevels[port];
+        metricsCounterIncrement( METRICS_COUNTER_OUTPUT_PORT_WRITES );
+        outputManagerChangesCount( (outputManagerPort_t)port, changed );
+    }
+}
+
+//=====[Implementations of private functions]==================================
+
+// Every output transition passes through here
+static void outputManagerChangesCount( outputManagerPort_t port, int changed )
+{
+    int output;
+
+    for ( output = 0; output < OUTPUT_MANAGER_NUMBER_OF_OUTPUTS; output++ ) {
+        if ( outputManagerPins[output].port == port &&
+             ( changed & ( 1 << outputManagerPins[output].bit ) ) ) {
+            metricsCounterIncrement( (metricsCounter_t)
+                ( METRICS_COUNTER_SIREN_CHANGES + output ) );
+            TRACE_BUFFER_WRITE( TRACE_EVENT_OUTPUT_CHANGE, output << 1 |
+                ( ( desiredLevels[port] >> outputManagerPins[output].bit ) & 1 ) );
+        }
+    }
+}
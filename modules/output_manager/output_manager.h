@@ -0,0 +1,31 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _OUTPUT_MANAGER_H_
+#define _OUTPUT_MANAGER_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+//=====[Declaration of public data types]======================================
+
+typedef enum {
+    OUTPUT_SIREN,
+    OUTPUT_STROBE_LIGHT,
+    OUTPUT_INCORRECT_CODE_LED,
+    OUTPUT_SYSTEM_BLOCKED_LED,
+    OUTPUT_MANAGER_NUMBER_OF_OUTPUTS,
+} outputManagerOutput_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void outputManagerInit();
+void outputManagerWrite( outputManagerOutput_t output, bool level );
+bool outputManagerRead( outputManagerOutput_t output );
+void outputManagerCommit();
+
+//=====[#include guards - end]=================================================
+
+#endif // _OUTPUT_MANAGER_H_
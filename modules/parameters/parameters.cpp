@@ -0,0 +1,207 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+#include "kvstore_global_api.h"
+
+#include "parameters.h"
+
+#include "code.h"
+#include "user_codes.h"
+#include "fire_alarm.h"
+#include "matrix_keypad.h"
+#include "temperature_sensor.h"
+
+#include <stddef.h>
+
+//=====[Declaration of private defines]========================================
+
+#define PARAMETERS_KVSTORE_KEY    "/kv/parameters"
+
+#define PARAMETER( name, type, field, minValue, maxValue ) \
+    { name, type, offsetof( parameters_t, field ), minValue, maxValue }
+
+//=====[Declaration of private data types]=====================================
+
+// What is written to flash
+typedef struct parametersImage {
+    uint32_t version;
+    parameters_t values;
+} parametersImage_t;
+
+//=====[Declaration and initialization of public global objects]===============
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+//=====[Declaration and initialization of private global variables]============
+
+static const parameterDescriptor_t parameterDescriptors[] = {
+    PARAMETER( "tempLimitC", PARAMETER_TYPE_FLOAT, temperatureLimitC,
+               FIRE_ALARM_TEMPERATURE_C_LIMIT_MIN,
+               FIRE_ALARM_TEMPERATURE_C_LIMIT_MAX ),
+    PARAMETER( "strobeGas_ms", PARAMETER_TYPE_INT, strobeTimeGas_ms,
+               FIRE_ALARM_STROBE_TIME_MIN_MS, FIRE_ALARM_STROBE_TIME_MAX_MS ),
+    PARAMETER( "strobeOverTemp_ms", PARAMETER_TYPE_INT, strobeTimeOverTemp_ms,
+               FIRE_ALARM_STROBE_TIME_MIN_MS, FIRE_ALARM_STROBE_TIME_MAX_MS ),
+    PARAMETER( "strobeBoth_ms", PARAMETER_TYPE_INT, strobeTimeGasAndOverTemp_ms,
+               FIRE_ALARM_STROBE_TIME_MIN_MS, FIRE_ALARM_STROBE_TIME_MAX_MS ),
+    PARAMETER( "debounce_ms", PARAMETER_TYPE_INT, debounceKeyTime_ms,
+               DEBOUNCE_KEY_TIME_MIN_MS, DEBOUNCE_KEY_TIME_MAX_MS ),
+    PARAMETER( "lm35Samples", PARAMETER_TYPE_INT, lm35NumberOfAvgSamples,
+               1, LM35_NUMBER_OF_AVG_SAMPLES_MAX ),
+    PARAMETER( "code", PARAMETER_TYPE_CODE, code, 0, 0 ),
+};
+
+static const parameters_t parametersDefault = {
+    TEMPERATURE_C_LIMIT_ALARM,
+    STROBE_TIME_GAS,
+    STROBE_TIME_OVER_TEMP,
+    STROBE_TIME_GAS_AND_OVER_TEMP,
+    DEBOUNCE_KEY_TIME_MS,
+    LM35_NUMBER_OF_AVG_SAMPLES,
+    { '1', '8', '0', '5', '2', '4' },
+};
+
+// RAM copy of what is in flash; the modules keep their own plain fields,
+// set from here, so no lookup is ever made on their update paths
+static parameters_t parametersCurrent;
+static bool parametersStored = false;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void parametersApply();
+static bool parametersSave();
+
+//=====[Implementations of public functions]===================================
+
+// Reads the stored parameters once at boot. A missing image, one written
+// by another PARAMETERS_VERSION or one with a value out of range leaves
+// every parameter at its default.
+void parametersInit()
+{
+    parametersImage_t image;
+    size_t actualSize = 0;
+
+    parametersCurrent = parametersDefault;
+    parametersStored = false;
+
+    if ( kv_get( PARAMETERS_KVSTORE_KEY, &image, sizeof(image),
+                 &actualSize ) == MBED_SUCCESS &&
+         actualSize == sizeof(image) &&
+         image.version == PARAMETERS_VERSION &&
+         parametersCheck( &image.values ) == nullptr ) {
+        parametersCurrent = image.values;
+        parametersStored = true;
+    }
+    parametersApply();
+}
+
+void parametersRead( parameters_t* parameters )
+{
+    *parameters = parametersCurrent;
+}
+
+// Returns the descriptor of the first value out of range, or nullptr. The
+// master code must not be a code some user already has.
+const parameterDescriptor_t* parametersCheck( const parameters_t* parameters )
+{
+    const char* base = (const char*)parameters;
+    const parameterDescriptor_t* descriptor;
+    float value;
+    int i;
+
+    for ( i = 0; i < parametersNumberOfDescriptorsRead(); i++ ) {
+        descriptor = &parameterDescriptors[i];
+        switch ( descriptor->type ) {
+            case PARAMETER_TYPE_INT:
+                value = *(const int32_t*)( base + descriptor->offset );
+            break;
+            case PARAMETER_TYPE_FLOAT:
+                value = *(const float*)( base + descriptor->offset );
+            break;
+            case PARAMETER_TYPE_CODE:
+            default:
+                if ( !codeSequenceCheck( base + descriptor->offset ) ||
+                     userCodesFind( base + descriptor->offset ) !=
+                     USER_CODES_NO_USER ) {
+                    return descriptor;
+                }
+            continue;
+        }
+        if ( !( value >= descriptor->minValue &&
+                value <= descriptor->maxValue ) ) {
+            return descriptor;
+        }
+    }
+    return nullptr;
+}
+
+// Checks every value, then applies and stores them all; nothing changes if
+// any value is out of range. Returns false if the values were applied but
+// could not be stored.
+bool parametersWrite( const parameters_t* parameters )
+{
+    if ( parametersCheck( parameters ) != nullptr ) {
+        return false;
+    }
+    parametersCurrent = *parameters;
+    parametersApply();
+    return parametersSave();
+}
+
+bool parametersCodeWrite( const char* code )
+{
+    parameters_t parameters = parametersCurrent;
+    memcpy( parameters.code, code, CODE_NUMBER_OF_KEYS );
+    return parametersWrite( &parameters );
+}
+
+// True when the values in use are the ones stored in flash
+bool parametersStoredRead()
+{
+    return parametersStored;
+}
+
+int parametersNumberOfDescriptorsRead()
+{
+    return sizeof(parameterDescriptors) / sizeof(parameterDescriptors[0]);
+}
+
+const parameterDescriptor_t* parametersDescriptorRead( int index )
+{
+    return &parameterDescriptors[index];
+}
+
+//=====[Implementations of private functions]==================================
+
+static void parametersApply()
+{
+    fireAlarmSettings_t settings;
+
+    settings.temperatureLimitC = parametersCurrent.temperatureLimitC;
+    settings.strobeTimeGas_ms = parametersCurrent.strobeTimeGas_ms;
+    settings.strobeTimeOverTemp_ms = parametersCurrent.strobeTimeOverTemp_ms;
+    settings.strobeTimeGasAndOverTemp_ms =
+        parametersCurrent.strobeTimeGasAndOverTemp_ms;
+    fireAlarmSettingsWrite( &settings );
+
+    matrixKeypadDebounceTimeWrite( parametersCurrent.debounceKeyTime_ms );
+    temperatureSensorAverageSamplesWrite(
+        parametersCurrent.lm35NumberOfAvgSamples );
+    codeWrite( parametersCurrent.code );
+}
+
+// Writing may block for a flash erase, so it is only done on a change
+static bool parametersSave()
+{
+    parametersImage_t image;
+
+    image.version = PARAMETERS_VERSION;
+    image.values = parametersCurrent;
+    parametersStored =
+        kv_set( PARAMETERS_KVSTORE_KEY, &image, sizeof(image), 0 ) ==
+        MBED_SUCCESS;
+    return parametersStored;
+}
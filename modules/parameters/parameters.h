@@ -0,0 +1,60 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _PARAMETERS_H_
+#define _PARAMETERS_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include "code.h"
+
+//=====[Declaration of public defines]=========================================
+
+// Raise whenever parameters_t changes, so that a stored image of the old
+// layout is ignored instead of being misread
+#define PARAMETERS_VERSION    2
+
+//=====[Declaration of public data types]======================================
+
+typedef struct parameters {
+    float temperatureLimitC;
+    int32_t strobeTimeGas_ms;
+    int32_t strobeTimeOverTemp_ms;
+    int32_t strobeTimeGasAndOverTemp_ms;
+    int32_t debounceKeyTime_ms;
+    int32_t lm35NumberOfAvgSamples;
+    char code[CODE_NUMBER_OF_KEYS];
+} parameters_t;
+
+typedef enum {
+    PARAMETER_TYPE_INT,
+    PARAMETER_TYPE_FLOAT,
+    PARAMETER_TYPE_CODE,
+} parameterType_t;
+
+// One entry per field of parameters_t; offset is where the field lives.
+// minValue and maxValue do not apply to PARAMETER_TYPE_CODE.
+typedef struct parameterDescriptor {
+    const char* name;
+    parameterType_t type;
+    int offset;
+    float minValue;
+    float maxValue;
+} parameterDescriptor_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void parametersInit();
+void parametersRead( parameters_t* parameters );
+const parameterDescriptor_t* parametersCheck( const parameters_t* parameters );
+bool parametersWrite( const parameters_t* parameters );
+bool parametersCodeWrite( const char* code );
+bool parametersStoredRead();
+
+int parametersNumberOfDescriptorsRead();
+const parameterDescriptor_t* parametersDescriptorRead( int index );
+
+//=====[#include guards - end]=================================================
+
+#endif // _PARAMETERS_H_
@@ -12,33 +12,172 @@
 #include "temperature_sensor.h"
 #include "gas_sensor.h"
 #include "event_log.h"
+#include "serial_protocol.h"
+#include "text_format.h"
+#include "async_flow.h"
+#include "parameters.h"
+#include "user_codes.h"
+#include "spsc_queue.h"
+#include "serial_tx_dma.h"
+#include "power_manager.h"
+#include "system_watchdog.h"
+#include "trace_buffer.h"
+#include "metrics.h"
 
 #include <cctype> //to solve  a isdigit() problem
 //=====[Declaration of private defines]========================================
 
+#define PC_SERIAL_COM_BAUD_RATE         115200
+#define PC_SERIAL_COM_AUX_TX            PD_5
+// USART2 RX on PA_3 rather than PD_6, whose EXTI line 6 is a keypad
+// column's, so that the AUX console can wake the panel too
+#define PC_SERIAL_COM_AUX_RX            PA_3
+
+// Queue sizes must be powers of two
+#define PC_SERIAL_COM_RX_BUFFER_SIZE     128
+#define PC_SERIAL_COM_TX_BUFFER_SIZE    2048
+#define PC_SERIAL_COM_TX_HIGH_BUFFER_SIZE  256
+#define PC_SERIAL_COM_RX_LINE_END_BUFFER_SIZE  8
+#define DATE_AND_TIME_NUMBER_OF_FIELDS     6
+
 //=====[Declaration of private data types]=====================================
 
+typedef struct dateAndTimeField {
+    const char* name;
+    const char* numberOfDigitsText;
+    int numberOfDigits;
+    int minValue;
+    int maxValue;
+    const char* range;
+} dateAndTimeField_t;
+
+typedef enum{
+    PC_SERIAL_BULK_IDLE,
+    PC_SERIAL_BULK_PENDING,
+    PC_SERIAL_BULK_ACTIVE,
+} pcSerialComBulkState_t;
+
 typedef enum{
-    PC_SERIAL_SET_DATE,
-    PC_SERIAL_COMMANDS,
-    PC_SERIAL_GET_CODE,
-    PC_SERIAL_SAVE_NEW_CODE,
-} pcSerialComMode_t;
+    PC_SERIAL_TX_NONE,
+    PC_SERIAL_TX_HIGH,
+    PC_SERIAL_TX_BULK_START,
+    PC_SERIAL_TX_BULK,
+    PC_SERIAL_TX_NORMAL,
+} pcSerialComTxSource_t;
 
 typedef enum{
-    DATE_AND_TIME_START,
-    DATE_AND_TIME_READ_YEAR,
-    DATE_AND_TIME_READ_MONTH,
-    DATE_AND_TIME_READ_DAY,
-    DATE_AND_TIME_READ_HOUR,
-    DATE_AND_TIME_READ_MINUTE,
-    DATE_AND_TIME_READ_SECOND,
-    DATE_AND_TIME_DONE,
-} dateAndTimeInputState_t;
+    PC_SERIAL_INPUT_OK,
+    PC_SERIAL_INPUT_NOT_A_NUMBER,
+    PC_SERIAL_INPUT_OUT_OF_RANGE,
+} pcSerialComInputError_t;
+
+// When a line end arrived, and where it went in the RX queue
+typedef struct pcSerialComLineEnd {
+    unsigned int position;
+    uint64_t time_us;
+} pcSerialComLineEnd_t;
+
+typedef struct pcSerialComDateAndTimeFrame {
+    int fieldIndex;
+    int values[DATE_AND_TIME_NUMBER_OF_FIELDS];
+    pcSerialComInputError_t error;
+} pcSerialComDateAndTimeFrame_t;
+
+struct pcSerialComSession;
+typedef asyncFlowStatus_t (*pcSerialComFlow_t)( struct pcSerialComSession* session );
+
+// SerialBase is used directly for single-byte access from the interrupts,
+// without the FileHandle layer of UnbufferedSerial. Bulk transfers on the
+// USB console go out by DMA (see serial_tx_dma), not by the asynchronous
+// write() of STM32 targets, which is interrupt driven and takes over the
+// UART vector from the RX handler.
+class PcSerialComUart : public SerialBase {
+public:
+    PcSerialComUart( PinName tx, PinName rx, int baud )
+        : SerialBase( tx, rx, baud ) {}
+    char getc() { return _base_getc(); }
+    void putc( char c ) { _base_putc( c ); }
+};
+
+// Everything one console connection needs: its UART, the rings shared with
+// that UART's interrupts and the state of its command parser. Sessions
+// never share state, so each one can be in a different mode.
+typedef struct pcSerialComSession {
+    PcSerialComUart* uart;
+    InterruptIn* rxWakeUp;
+
+    // The RX interrupt fills rxQueue for the superloop, and the superloop
+    // fills the TX queues for the TX interrupt
+    SpscQueue<char, PC_SERIAL_COM_RX_BUFFER_SIZE> rxQueue;
+    SpscQueue<char, PC_SERIAL_COM_TX_BUFFER_SIZE> txQueue;
+    volatile bool txInterruptEnabled;
+    pcSerialComStats_t stats;
+
+    // Every line end is stamped on arrival, for requests that need to know
+    // when they were received rather than when the superloop got to them.
+    // A line end with no stamp (the stamp queue was full) reads as 0.
+    SpscQueue<pcSerialComLineEnd_t, PC_SERIAL_COM_RX_LINE_END_BUFFER_SIZE>
+        rxLineEndQueue;
+    uint64_t lineEnd_us;
+
+    // Notifications have their own ring and are spliced into the normal
+    // output (ring or bulk transfer) where it is at the start of a line
+    SpscQueue<char, PC_SERIAL_COM_TX_HIGH_BUFFER_SIZE> txHighQueue;
+    volatile bool normalAtLineStart;
+    volatile bool highInLine;
+
+    // Bulk transfer: the scatter list is sent once the TX queue has been
+    // read up to bulkTxMark, so it keeps its place among the queued strings
+    volatile pcSerialComBulkState_t bulkState;
+    const pcSerialComChunk_t* bulkChunks;
+    int bulkNumberOfChunks;
+    volatile int bulkChunkIndex;
+    volatile int bulkByteIndex;
+    volatile unsigned int bulkTxMark;
+    pcSerialComBulkDoneCallback_t bulkDoneCallback;
+    // Binary data has no lines, so nothing is spliced into it
+    volatile bool bulkBinary;
+    // With bulkDma the transfer goes out by DMA, one segment at a time,
+    // instead of one byte per TX interrupt. A text segment ends at a line
+    // end, so notifications still go in between lines.
+    bool bulkDma;
+    volatile bool bulkDmaBusy;
+    volatile int bulkDmaLength;
+
+    // Input is assembled into tokens of tokenWidth characters (one command
+    // key, a whole code, one date field) or cut short by a line end. In the
+    // command menu a token starting with '{' is a protocol frame that runs
+    // up to the line end instead.
+    char tokenBuffer[SERIAL_PROTOCOL_FRAME_MAX_LENGTH + 1];
+    int tokenLength;
+    int tokenWidth;
+    bool tokenReady;
+    bool tokenIsFrame;
+    bool frameOverflow;
+
+    // Multi-step entries (date and time, code, new code) run as flows that
+    // wait for tokens; while one runs it gets every token instead of the
+    // command menu. The frame keeps what a flow needs across its waits.
+    pcSerialComFlow_t flow;
+    asyncFlow_t flowState;
+    union {
+        pcSerialComDateAndTimeFrame_t dateAndTime;
+    } flowFrame;
+
+    // A code entered here and not yet checked by the alarm
+    bool codePending;
+    char code[CODE_NUMBER_OF_KEYS];
+} pcSerialComSession_t;
 
 //=====[Declaration and initialization of public global objects]===============
 
-UnbufferedSerial uartUsb(USBTX, USBRX, 115200);
+PcSerialComUart uartUsb(USBTX, USBRX, PC_SERIAL_COM_BAUD_RATE);
+PcSerialComUart uartAux(PC_SERIAL_COM_AUX_TX, PC_SERIAL_COM_AUX_RX,
+                        PC_SERIAL_COM_BAUD_RATE);
+
+// The RX pins wake the panel in standby, when the UARTs stop
+InterruptIn uartUsbRxWakeUp(USBRX);
+InterruptIn uartAuxRxWakeUp(PC_SERIAL_COM_AUX_RX);
 
 //=====[Declaration of external public global variables]=======================
 
@@ -48,483 +187,1158 @@ char codeSequenceFromPcSerialCom[CODE_NUMBER_OF_KEYS];
 
 //=====[Declaration and initialization of private global variables]============
 
-static pcSerialComMode_t pcSerialComMode = PC_SERIAL_COMMANDS;
-static dateAndTimeInputState_t dateAndTimeInputState = DATE_AND_TIME_DONE;
-static bool codeComplete = false;
-static int numberOfCodeChars = 0;
-static char dateAndTimerInputBuffer[3]; // Almacena los caracteres de entrada para date and time
-char yearBuffer[5]  = "";
-char monthBuffer[3] = "";
-char dayBuffer[3]   = "";
-char hourBuffer[3]  = "";
-char minuteBuffer[3]= "";
-char secondBuffer[3]= "";
+static PcSerialComUart* const sessionUarts[PC_SERIAL_COM_NUMBER_OF_SESSIONS] = {
+    &uartUsb,
+    &uartAux,
+};
+static InterruptIn* const sessionRxWakeUps[PC_SERIAL_COM_NUMBER_OF_SESSIONS] = {
+    &uartUsbRxWakeUp,
+    &uartAuxRxWakeUp,
+};
+static const PinName sessionRxPins[PC_SERIAL_COM_NUMBER_OF_SESSIONS] = {
+    USBRX,
+    PC_SERIAL_COM_AUX_RX,
+};
+static pcSerialComSession_t sessions[PC_SERIAL_COM_NUMBER_OF_SESSIONS];
+
+// Each session holds its own pending code. The alarm checks them one at a
+// time through codeSequenceFromPcSerialCom; codeSession is where the one
+// being checked was typed, so the verdict goes back to that console only.
+static pcSerialComSession_t* codeSession = nullptr;
+
+static const dateAndTimeField_t dateAndTimeFields[DATE_AND_TIME_NUMBER_OF_FIELDS] = {
+    { "year",    "four", 4, 1900, 2099, "YYYY"  },
+    { "month",   "two",  2,    1,   12, "01-12" },
+    { "day",     "two",  2,    1,   31, "01-31" },
+    { "hour",    "two",  2,    0,   23, "00-23" },
+    { "minutes", "two",  2,    0,   59, "00-59" },
+    { "seconds", "two",  2,    0,   59, "00-59" },
+};
+
+// One export buffer serves every session; a session that finds it taken
+// prints the events through its TX ring instead
+static char eventsExportBuffer[EVENT_LOG_MAX_STORAGE][EVENT_STR_LENGTH + 2];
+static pcSerialComChunk_t eventsExportChunks[EVENT_LOG_MAX_STORAGE];
+static volatile bool eventsExportBusy = false;
+
+// One chunk per line, so that notifications can be spliced between lines
+// even while the menu goes out as a bulk transfer
+#define PC_SERIAL_COM_CHUNK( text )    { text, sizeof(text) - 1 }
+static const pcSerialComChunk_t availableCommandsChunks[] = {
+    PC_SERIAL_COM_CHUNK( "Available commands:\r\n" ),
+    PC_SERIAL_COM_CHUNK( "Press '1' to get the alarm state\r\n" ),
+    PC_SERIAL_COM_CHUNK( "Press '2' to get the gas detector state\r\n" ),
+    PC_SERIAL_COM_CHUNK( "Press '3' to get the over temperature detector state\r\n" ),
+    PC_SERIAL_COM_CHUNK( "Press '4' to enter the code to deactivate the alarm\r\n" ),
+    PC_SERIAL_COM_CHUNK( "Press '5' to enter a new code to deactivate the alarm\r\n" ),
+    PC_SERIAL_COM_CHUNK( "Press 'f' or 'F' to get lm35 reading in Fahrenheit\r\n" ),
+    PC_SERIAL_COM_CHUNK( "Press 'c' or 'C' to get lm35 reading in Celsius\r\n" ),
+    PC_SERIAL_COM_CHUNK( "Press 's' or 'S' to set the date and time\r\n" ),
+    PC_SERIAL_COM_CHUNK( "Press 't' or 'T' to get the date and time\r\n" ),
+    PC_SERIAL_COM_CHUNK( "Press 'e' or 'E' to get the stored events\r\n" ),
+    PC_SERIAL_COM_CHUNK( "Press 'q' or 'Q' to get the serial queue statistics\r\n" ),
+    PC_SERIAL_COM_CHUNK( "Press 'p' or 'P' to get the power statistics\r\n" ),
+    PC_SERIAL_COM_CHUNK( "Press 'w' or 'W' to get the reason of the last reset\r\n" ),
+    PC_SERIAL_COM_CHUNK( "Press 'x' or 'X' to dump the trace buffer in binary\r\n" ),
+    PC_SERIAL_COM_CHUNK( "Press 'm' or 'M' to get the metrics\r\n" ),
+    PC_SERIAL_COM_CHUNK( "Send {\"id\":<n>,\"cmd\":\"status\"} and a new line for a JSON status\r\n" ),
+    PC_SERIAL_COM_CHUNK( "\r\n" ),
+};
 
 //=====[Declarations (prototypes) of private functions]========================
 
-static void pcSerialComStringRead( char* str, int strLength );
+static void pcSerialComSessionUpdate( pcSerialComSession_t* session );
+static void pcSerialComTxEnqueue( pcSerialComSession_t* session,
+                                  const char* str );
+static bool pcSerialComTxHighEnqueue( pcSerialComSession_t* session,
+                                      const char* str );
+static bool pcSerialComTxFrameEnqueue( pcSerialComSession_t* session,
+                                       const char* frame );
+static int pcSerialComTxPending( pcSerialComSession_t* session );
+static int pcSerialComTxHighPending( pcSerialComSession_t* session );
+static bool pcSerialComTokenDispatch( pcSerialComSession_t* session );
+static void pcSerialComFrameCharAdd( pcSerialComSession_t* session,
+                                     char receivedChar );
+static void pcSerialComFrameDispatch( pcSerialComSession_t* session );
+
+static void pcSerialComLineEndTimeUpdate( pcSerialComSession_t* session );
+static void pcSerialComRxIsr( pcSerialComSession_t* session );
+static void pcSerialComTxIsr( pcSerialComSession_t* session );
+static void pcSerialComTxStart( pcSerialComSession_t* session );
+static pcSerialComTxSource_t pcSerialComTxSourceSelect( pcSerialComSession_t* session );
+static void pcSerialComTxHighPut( pcSerialComSession_t* session );
+static void pcSerialComTxNormalPut( pcSerialComSession_t* session );
+static void pcSerialComTxStop( pcSerialComSession_t* session );
 
-static void pcSerialComSetDateAndTime( char receivedChar );
-static void pcSerialComGetCodeUpdate( char receivedChar );
-static void pcSerialComSaveNewCodeUpdate( char receivedChar );
+static bool pcSerialComBulkStart( pcSerialComSession_t* session,
+                                  const pcSerialComChunk_t* chunks,
+                                  int numberOfChunks,
+                                  pcSerialComBulkDoneCallback_t onDone,
+                                  bool binary );
+static void pcSerialComBulkBegin( pcSerialComSession_t* session );
+static void pcSerialComBulkPutNextByte( pcSerialComSession_t* session );
+static void pcSerialComBulkAdvance( pcSerialComSession_t* session,
+                                    int numberOfBytes );
+#if SERIAL_TX_DMA_ENABLED
+static void pcSerialComBulkDmaStart( pcSerialComSession_t* session );
+static void pcSerialComBulkDmaDone( pcSerialComSession_t* session );
+#endif
+static void pcSerialComBulkFinish( pcSerialComSession_t* session );
+static void pcSerialComChunksWrite( pcSerialComSession_t* session,
+                                    const pcSerialComChunk_t* chunks,
+                                    int numberOfChunks );
+static void pcSerialComEventsExportDone();
 
-static void pcSerialComCommandUpdate( char receivedChar );
+static void pcSerialComFlowStart( pcSerialComSession_t* session,
+                                  pcSerialComFlow_t flow );
+static void pcSerialComFlowResume( pcSerialComSession_t* session );
+static asyncFlowStatus_t pcSerialComDateAndTimeFlow( pcSerialComSession_t* session );
+static void pcSerialComDateAndTimeFieldPrompt( pcSerialComSession_t* session,
+                                               int fieldIndex,
+                                               pcSerialComInputError_t error );
+static pcSerialComInputError_t pcSerialComDateAndTimeFieldParse(
+    pcSerialComSession_t* session, int fieldIndex, int* value );
+static asyncFlowStatus_t pcSerialComGetCodeFlow( pcSerialComSession_t* session );
+static asyncFlowStatus_t pcSerialComSaveNewCodeFlow( pcSerialComSession_t* session );
+static void pcSerialComCodeTokenCopy( pcSerialComSession_t* session,
+                                      char* code, const char* token,
+                                      int length );
 
-static void availableCommands();
-static void commandShowCurrentAlarmState();
-static void commandShowCurrentGasDetectorState();
-static void commandShowCurrentOverTemperatureDetectorState();
-static void commandEnterCodeSequence();
-static void commandEnterNewCode();
-static void commandShowCurrentTemperatureInCelsius();
-static void commandShowCurrentTemperatureInFahrenheit();
-static void commandSetDateAndTime();
-static void commandShowDateAndTime();
-static void commandShowStoredEvents();
+static void pcSerialComCommandUpdate( pcSerialComSession_t* session,
+                                      char receivedChar );
+
+static void availableCommands( pcSerialComSession_t* session );
+static void commandShowCurrentAlarmState( pcSerialComSession_t* session );
+static void commandShowCurrentGasDetectorState( pcSerialComSession_t* session );
+static void commandShowCurrentOverTemperatureDetectorState( pcSerialComSession_t* session );
+static void commandEnterCodeSequence( pcSerialComSession_t* session );
+static void commandEnterNewCode( pcSerialComSession_t* session );
+static void commandShowCurrentTemperatureInCelsius( pcSerialComSession_t* session );
+static void commandShowCurrentTemperatureInFahrenheit( pcSerialComSession_t* session );
+static void commandSetDateAndTime( pcSerialComSession_t* session );
+static void commandShowDateAndTime( pcSerialComSession_t* session );
+static void commandShowStoredEvents( pcSerialComSession_t* session );
+static void commandShowSerialQueues( pcSerialComSession_t* session );
+static void commandShowPowerStats( pcSerialComSession_t* session );
+static void commandShowResetReason( pcSerialComSession_t* session );
+static void commandDumpTraceBuffer( pcSerialComSession_t* session );
+static void commandShowMetrics( pcSerialComSession_t* session );
 
 //=====[Implementations of public functions]===================================
 
 void pcSerialComInit()
 {
-    availableCommands();
+    int i;
+#if SERIAL_TX_DMA_ENABLED
+    sessions[PC_SERIAL_COM_SESSION_USB].bulkDma = true;
+    serialTxDmaInit( callback( &pcSerialComBulkDmaDone,
+                               &sessions[PC_SERIAL_COM_SESSION_USB] ) );
+#endif
+    for ( i = 0; i < PC_SERIAL_COM_NUMBER_OF_SESSIONS; i++ ) {
+        pcSerialComSession_t* session = &sessions[i];
+        session->uart = sessionUarts[i];
+        session->tokenWidth = 1;
+        session->normalAtLineStart = true;
+        session->uart->attach( callback( &pcSerialComRxIsr, session ),
+                               SerialBase::RxIrq );
+        // InterruptIn made the RX pin a plain input: it goes back to the
+        // UART, and its EXTI line still sees the pin in that function
+        pinmap_pinout( sessionRxPins[i], serial_rx_pinmap() );
+        session->rxWakeUp = sessionRxWakeUps[i];
+        session->rxWakeUp->fall( &powerManagerWakeUp );
+        session->rxWakeUp->disable_irq();
+        availableCommands( session );
+    }
 }
 
-char pcSerialComCharRead()
+void pcSerialComUpdate()
 {
-    char receivedChar = '\0';
-    if( uartUsb.readable() ) {
-        uartUsb.read( &receivedChar, 1 );
+    int i;
+    for ( i = 0; i < PC_SERIAL_COM_NUMBER_OF_SESSIONS; i++ ) {
+        pcSerialComSessionUpdate( &sessions[i] );
     }
-    return receivedChar;
 }
 
+// Notifications go to every connected console
 void pcSerialComStringWrite( const char* str )
 {
-    uartUsb.write( str, strlen(str) );
+    int i;
+    for ( i = 0; i < PC_SERIAL_COM_NUMBER_OF_SESSIONS; i++ ) {
+        pcSerialComTxEnqueue( &sessions[i], str );
+    }
+}
+
+// Alarm and state change notifications go to every console ahead of any
+// menu or dump in progress
+void pcSerialComNotificationWrite( const char* str )
+{
+    int i;
+    for ( i = 0; i < PC_SERIAL_COM_NUMBER_OF_SESSIONS; i++ ) {
+        pcSerialComTxHighEnqueue( &sessions[i], str );
+    }
+}
+
+void pcSerialComSessionStringWrite( pcSerialComSessionId_t sessionId,
+                                    const char* str )
+{
+    pcSerialComTxEnqueue( &sessions[sessionId], str );
 }
 
-void pcSerialComUpdate()
+bool pcSerialComSessionFrameWrite( pcSerialComSessionId_t sessionId,
+                                   const char* frame )
 {
-    char receivedChar = pcSerialComCharRead();
-    if( receivedChar != '\0' ) {
-        switch ( pcSerialComMode ) {
-            
-            case PC_SERIAL_SET_DATE:
-                pcSerialComSetDateAndTime( receivedChar );
+    return pcSerialComTxFrameEnqueue( &sessions[sessionId], frame );
+}
+
+void pcSerialComCodeReplyWrite( const char* str )
+{
+    if ( codeSession != nullptr ) {
+        pcSerialComTxHighEnqueue( codeSession, str );
+    }
+}
+
+// True while a session has a code waiting. The oldest in session order is
+// copied to codeSequenceFromPcSerialCom and stays there until
+// pcSerialComCodeCompleteWrite( false ) releases it.
+bool pcSerialComCodeCompleteRead()
+{
+    int i;
+
+    if ( codeSession != nullptr && codeSession->codePending ) {
+        return true;
+    }
+    for ( i = 0; i < PC_SERIAL_COM_NUMBER_OF_SESSIONS; i++ ) {
+        if ( sessions[i].codePending ) {
+            codeSession = &sessions[i];
+            memcpy( codeSequenceFromPcSerialCom, codeSession->code,
+                    CODE_NUMBER_OF_KEYS );
+            return true;
+        }
+    }
+    return false;
+}
+
+void pcSerialComCodeCompleteWrite( bool state )
+{
+    if ( codeSession != nullptr ) {
+        codeSession->codePending = state;
+    }
+}
+
+void pcSerialComStatsRead( pcSerialComSessionId_t sessionId,
+                           pcSerialComStats_t* stats )
+{
+    *stats = sessions[sessionId].stats;
+}
+
+int pcSerialComTxPendingRead( pcSerialComSessionId_t sessionId )
+{
+    return pcSerialComTxPending( &sessions[sessionId] );
+}
+
+int pcSerialComTxHighPendingRead( pcSerialComSessionId_t sessionId )
+{
+    return pcSerialComTxHighPending( &sessions[sessionId] );
+}
+
+bool pcSerialComBulkWrite( pcSerialComSessionId_t sessionId,
+                          const pcSerialComChunk_t* chunks,
+                          int numberOfChunks,
+                          pcSerialComBulkDoneCallback_t onDone )
+{
+    return pcSerialComBulkStart( &sessions[sessionId], chunks,
+                                 numberOfChunks, onDone, false );
+}
+
+// As pcSerialComBulkWrite(), for data that is not text: notifications wait
+// until the whole transfer is out instead of going in at line ends
+bool pcSerialComBulkBinaryWrite( pcSerialComSessionId_t sessionId,
+                                 const pcSerialComChunk_t* chunks,
+                                 int numberOfChunks,
+                                 pcSerialComBulkDoneCallback_t onDone )
+{
+    return pcSerialComBulkStart( &sessions[sessionId], chunks,
+                                 numberOfChunks, onDone, true );
+}
+
+bool pcSerialComBulkBusyRead( pcSerialComSessionId_t sessionId )
+{
+    return sessions[sessionId].bulkState != PC_SERIAL_BULK_IDLE;
+}
+
+// True when no session has input to parse or output to send, so the
+// superloop may stand by until the next byte arrives
+bool pcSerialComIdleRead()
+{
+    int i;
+    for ( i = 0; i < PC_SERIAL_COM_NUMBER_OF_SESSIONS; i++ ) {
+        if ( !sessions[i].rxQueue.empty() || !sessions[i].txQueue.empty() ||
+             !sessions[i].txHighQueue.empty() ||
+             sessions[i].bulkState != PC_SERIAL_BULK_IDLE ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// An attached RX interrupt holds the sleep manager's deep sleep lock, so
+// the UARTs let go of theirs for a standby and the start bit of the next
+// character wakes the panel from its RX pin instead. That character and
+// the next few are lost while the clocks restart.
+void pcSerialComStandbyEnter()
+{
+    int i;
+    for ( i = 0; i < PC_SERIAL_COM_NUMBER_OF_SESSIONS; i++ ) {
+        sessions[i].rxWakeUp->enable_irq();
+        sessions[i].uart->attach( nullptr, SerialBase::RxIrq );
+    }
+}
+
+// Whatever the UARTs received since the standby began is read at once
+void pcSerialComStandbyExit()
+{
+    int i;
+    for ( i = 0; i < PC_SERIAL_COM_NUMBER_OF_SESSIONS; i++ ) {
+        sessions[i].uart->attach( callback( &pcSerialComRxIsr, &sessions[i] ),
+                                  SerialBase::RxIrq );
+        sessions[i].rxWakeUp->disable_irq();
+    }
+}
+
+//=====[Implementations of private functions]==================================
+
+// Consumes everything the session received since the last pass. It only
+// stops early after a code has been entered, so the alarm can check it
+// before any further input is taken.
+static void pcSerialComSessionUpdate( pcSerialComSession_t* session )
+{
+    char receivedChar;
+    bool codeEntered = false;
+
+    // Left over when the alarm went off before it was checked; it must not
+    // silence the next alarm
+    if ( session->codePending && !sirenStateRead() ) {
+        session->codePending = false;
+        pcSerialComTxEnqueue( session, "\r\nThe alarm is no longer activated\r\n\r\n" );
+    }
+
+    while ( !codeEntered && session->rxQueue.pop( &receivedChar ) ) {
+        if ( receivedChar == '\r' || receivedChar == '\n' ) {
+            pcSerialComLineEndTimeUpdate( session );
+        }
+        if ( session->tokenIsFrame ||
+             ( session->tokenLength == 0 &&
+               session->flow == nullptr &&
+               receivedChar == SERIAL_PROTOCOL_FRAME_START ) ) {
+            pcSerialComFrameCharAdd( session, receivedChar );
+            continue;
+        }
+        if ( receivedChar == '\r' || receivedChar == '\n' ) {
+            if ( session->tokenLength > 0 ) {
+                codeEntered = pcSerialComTokenDispatch( session );
+            }
+            continue;
+        }
+        session->tokenBuffer[session->tokenLength] = receivedChar;
+        session->tokenLength++;
+        if ( session->tokenLength >= session->tokenWidth ) {
+            codeEntered = pcSerialComTokenDispatch( session );
+        }
+    }
+}
+
+// Never blocks: the string is queued and shifted out by the TX interrupt.
+// When the queue is full the rest of the string is dropped and counted.
+static void pcSerialComTxEnqueue( pcSerialComSession_t* session,
+                                  const char* str )
+{
+    while ( *str != '\0' ) {
+        if ( !session->txQueue.push( *str ) ) {
+            session->stats.txDroppedBytes += strlen( str );
+            metricsCounterAdd( METRICS_COUNTER_SERIAL_TX_DROPPED_BYTES,
+                               strlen( str ) );
             break;
+        }
+        str++;
+    }
+    pcSerialComTxStart( session );
+}
+
+// A notification is queued whole or not at all; it must never be cut
+static bool pcSerialComTxHighEnqueue( pcSerialComSession_t* session,
+                                      const char* str )
+{
+    unsigned int length = strlen( str );
+    if ( length > session->txHighQueue.space() ) {
+        session->stats.txHighDroppedBytes += length;
+        metricsCounterAdd( METRICS_COUNTER_SERIAL_TX_DROPPED_BYTES, length );
+        return false;
+    }
+    while ( *str != '\0' ) {
+        session->txHighQueue.push( *str );
+        str++;
+    }
+    pcSerialComTxStart( session );
+    return true;
+}
+
+// For machine-readable output: a frame is queued whole or not at all, so a
+// full TX queue never leaves a truncated line
+static bool pcSerialComTxFrameEnqueue( pcSerialComSession_t* session,
+                                       const char* frame )
+{
+    unsigned int length = strlen( frame );
+    if ( length > session->txQueue.space() ) {
+        session->stats.txDroppedBytes += length;
+        metricsCounterAdd( METRICS_COUNTER_SERIAL_TX_DROPPED_BYTES, length );
+        return false;
+    }
+    pcSerialComTxEnqueue( session, frame );
+    return true;
+}
+
+static int pcSerialComTxPending( pcSerialComSession_t* session )
+{
+    return session->txQueue.size();
+}
+
+static int pcSerialComTxHighPending( pcSerialComSession_t* session )
+{
+    return session->txHighQueue.size();
+}
+
+// Hands the assembled token to the running flow, or to the command menu;
+// returns true if it was a code to deactivate the alarm
+static bool pcSerialComTokenDispatch( pcSerialComSession_t* session )
+{
+    bool codeEntered = false;
+
+    if ( session->flow == nullptr ) {
+        pcSerialComCommandUpdate( session, session->tokenBuffer[0] );
+    } else {
+        codeEntered = ( session->flow == &pcSerialComGetCodeFlow );
+        session->tokenReady = true;
+        pcSerialComFlowResume( session );
+        session->tokenReady = false;
+    }
+    session->tokenLength = 0;
+    return codeEntered;
+}
+
+// Frames longer than the buffer are discarded up to their line end
+static void pcSerialComFrameCharAdd( pcSerialComSession_t* session,
+                                     char receivedChar )
+{
+    session->tokenIsFrame = true;
+    if ( receivedChar == '\r' || receivedChar == '\n' ) {
+        pcSerialComFrameDispatch( session );
+    } else if ( session->tokenLength < SERIAL_PROTOCOL_FRAME_MAX_LENGTH ) {
+        session->tokenBuffer[session->tokenLength] = receivedChar;
+        session->tokenLength++;
+    } else {
+        session->frameOverflow = true;
+    }
+}
+
+static void pcSerialComFrameDispatch( pcSerialComSession_t* session )
+{
+    char response[SERIAL_PROTOCOL_RESPONSE_MAX_LENGTH] = "";
 
-            case PC_SERIAL_COMMANDS:
-                pcSerialComCommandUpdate( receivedChar );
+    session->tokenBuffer[session->tokenLength] = '\0';
+    if ( session->frameOverflow ) {
+        serialProtocolErrorWrite( "frame too long", response );
+    } else {
+        serialProtocolRequestProcess( session - sessions,
+                                      session->tokenBuffer,
+                                      session->lineEnd_us, response );
+    }
+    strcat( response, "\r\n" );
+    pcSerialComTxFrameEnqueue( session, response );
+
+    session->tokenLength = 0;
+    session->tokenIsFrame = false;
+    session->frameOverflow = false;
+}
+
+// Sets lineEnd_us to the stamp of the line end just taken from the RX
+// queue. Any stamps before it belong to line ends already taken.
+static void pcSerialComLineEndTimeUpdate( pcSerialComSession_t* session )
+{
+    unsigned int position = session->rxQueue.readCount() - 1;
+    pcSerialComLineEnd_t lineEnd;
+
+    session->lineEnd_us = 0;
+    while ( session->rxLineEndQueue.peek( &lineEnd ) &&
+            (int)( position - lineEnd.position ) >= 0 ) {
+        session->rxLineEndQueue.pop( &lineEnd );
+        if ( lineEnd.position == position ) {
+            session->lineEnd_us = lineEnd.time_us;
             break;
+        }
+    }
+}
 
-            case PC_SERIAL_GET_CODE:
-                pcSerialComGetCodeUpdate( receivedChar );
+// Drains the receive register; bytes that do not fit are discarded. A line
+// end is stamped before it is queued, so the superloop never finds it
+// without its stamp.
+static void pcSerialComRxIsr( pcSerialComSession_t* session )
+{
+    pcSerialComLineEnd_t lineEnd;
+    char receivedChar;
+    while ( session->uart->readable() ) {
+        receivedChar = session->uart->getc();
+        if ( session->rxQueue.space() > 0 ) {
+            if ( receivedChar == '\r' || receivedChar == '\n' ) {
+                lineEnd.position = session->rxQueue.writeCount();
+                lineEnd.time_us = dateAndTimeMonotonicRead();
+                session->rxLineEndQueue.push( lineEnd );
+            }
+            session->rxQueue.push( receivedChar );
+            session->stats.rxBytes++;
+            metricsCounterIncrement( METRICS_COUNTER_SERIAL_RX_BYTES );
+        } else {
+            session->stats.rxDroppedBytes++;
+            metricsCounterIncrement( METRICS_COUNTER_SERIAL_RX_DROPPED_BYTES );
+        }
+    }
+    powerManagerWakeUp();
+}
+
+// Feeds the transmit register one character at a time from whichever
+// source pcSerialComTxSourceSelect() picks, and disables itself once there
+// is nothing to send
+static void pcSerialComTxIsr( pcSerialComSession_t* session )
+{
+    while ( session->uart->writeable() ) {
+        switch ( pcSerialComTxSourceSelect( session ) ) {
+            case PC_SERIAL_TX_HIGH:
+                pcSerialComTxHighPut( session );
             break;
 
-            case PC_SERIAL_SAVE_NEW_CODE:
-                pcSerialComSaveNewCodeUpdate( receivedChar );
+            case PC_SERIAL_TX_BULK_START:
+                pcSerialComBulkBegin( session );
             break;
-            default:
-                pcSerialComMode = PC_SERIAL_COMMANDS;
+
+            case PC_SERIAL_TX_BULK:
+#if SERIAL_TX_DMA_ENABLED
+                if ( session->bulkDma ) {
+                    pcSerialComBulkDmaStart( session );
+                    return;
+                }
+#endif
+                pcSerialComBulkPutNextByte( session );
             break;
+
+            case PC_SERIAL_TX_NORMAL:
+                pcSerialComTxNormalPut( session );
+            break;
+
+            case PC_SERIAL_TX_NONE:
+            default:
+                pcSerialComTxStop( session );
+                return;
         }
-    }    
+    }
 }
 
-bool pcSerialComCodeCompleteRead()
+// A notification, once started, is finished before anything else. Otherwise
+// notifications go first whenever the normal output is between lines, or
+// has nothing more to send (a prompt waiting for input, for instance).
+// Nothing is picked while a DMA segment owns the UART.
+static pcSerialComTxSource_t pcSerialComTxSourceSelect( pcSerialComSession_t* session )
 {
-    return codeComplete;
+    bool highPending = !session->txHighQueue.empty();
+    bool normalIdle = session->txQueue.empty() &&
+                      session->bulkState == PC_SERIAL_BULK_IDLE;
+
+    if ( session->bulkDmaBusy ) {
+        return PC_SERIAL_TX_NONE;
+    }
+    if ( session->highInLine ) {
+        return highPending ? PC_SERIAL_TX_HIGH : PC_SERIAL_TX_NONE;
+    }
+    if ( highPending && ( session->normalAtLineStart || normalIdle ) ) {
+        return PC_SERIAL_TX_HIGH;
+    }
+    if ( session->bulkState == PC_SERIAL_BULK_PENDING &&
+         session->txQueue.readCount() == session->bulkTxMark ) {
+        return PC_SERIAL_TX_BULK_START;
+    }
+    if ( session->bulkState == PC_SERIAL_BULK_ACTIVE ) {
+        return PC_SERIAL_TX_BULK;
+    }
+    if ( !session->txQueue.empty() ) {
+        return PC_SERIAL_TX_NORMAL;
+    }
+    return PC_SERIAL_TX_NONE;
 }
 
-void pcSerialComCodeCompleteWrite( bool state )
+static void pcSerialComTxHighPut( pcSerialComSession_t* session )
 {
-    codeComplete = state;
+    char c;
+    session->txHighQueue.pop( &c );
+    session->uart->putc( c );
+    session->highInLine = ( c != '\n' );
+    session->stats.txBytes++;
+    metricsCounterIncrement( METRICS_COUNTER_SERIAL_TX_BYTES );
 }
 
-//=====[Implementations of private functions]==================================
+static void pcSerialComTxNormalPut( pcSerialComSession_t* session )
+{
+    char c;
+    session->txQueue.pop( &c );
+    session->uart->putc( c );
+    session->normalAtLineStart = ( c == '\n' );
+    session->stats.txBytes++;
+    metricsCounterIncrement( METRICS_COUNTER_SERIAL_TX_BYTES );
+}
 
-static void pcSerialComStringRead( char* str, int strLength )
-{
-    int strIndex;
-    for ( strIndex = 0; strIndex < strLength; strIndex++) {
-        
-        uartUsb.read( &str[strIndex] , 1 );
-        uartUsb.write( &str[strIndex] ,1 ); //eco del mensaje recibido
-    }
-    str[strLength]='\0';
-}
-
-
-static void pcSerialComSetDateAndTime( char receivedChar )
-{
-    if (receivedChar != '\0') {
-        // Siempre debes recibir caracteres mientras el estado no sea 'Done'
-        // Procesa el caracter recibido según el estado actual
-        switch (dateAndTimeInputState) {
-            case DATE_AND_TIME_START:
-                pcSerialComStringWrite("Type four digits for the current year (YYYY): ");
-                dateAndTimeInputState = DATE_AND_TIME_READ_YEAR;
-                break;
-            case DATE_AND_TIME_READ_YEAR:
-                // Verifica si el caracter recibido es un dígito válido
-                if (isdigit(receivedChar)) {
-                    // Agrega el caracter al búfer de entrada si hay espacio
-                    if (strlen(dateAndTimerInputBuffer) < 4) {
-                        dateAndTimerInputBuffer[strlen(dateAndTimerInputBuffer)] = receivedChar;
-                        dateAndTimerInputBuffer[strlen(dateAndTimerInputBuffer) + 1] = '\0';
-                    }
-
-                    // Verifica si se han ingresado cuatro dígitos
-                    if (strlen(dateAndTimerInputBuffer) == 4) {
-                        int yearValue = atoi(dateAndTimerInputBuffer);
-                        if (yearValue >= 1900 && yearValue <= 2099) {
-                            // El año se ha ingresado correctamente
-                            // Cambia al siguiente estado
-                            dateAndTimeInputState = DATE_AND_TIME_READ_MONTH;
-                            pcSerialComStringWrite("\r\nType two digits for the current month (01-12): ");
-                            // Limpia el búfer de entrada para el próximo campo
-                            dateAndTimerInputBuffer[0] = '\0';
-                        } else {
-                            // El año está fuera del rango, muestra un mensaje de error
-                            pcSerialComStringWrite("\r\nInvalid year. Please try again (YYYY): ");
-                            // Limpia el búfer de entrada para volver a ingresar el año
-                            dateAndTimerInputBuffer[0] = '\0';
-                        }
-                    }
-                } else {
-                    // El caracter no es un dígito válido, muestra un mensaje de error
-                    pcSerialComStringWrite("\r\nInvalid input. Please try again (YYYY): ");
-                    // Limpia el búfer de entrada para volver a ingresar el año
-                    dateAndTimerInputBuffer[0] = '\0';
-                }
-                break;
-            case DATE_AND_TIME_READ_MONTH:
-                // Verifica si el caracter recibido es un dígito válido
-                if (isdigit(receivedChar)) {
-                    // Agrega el caracter al búfer de entrada si hay espacio
-                    if (strlen(dateAndTimerInputBuffer) < 2) {
-                        dateAndTimerInputBuffer[strlen(dateAndTimerInputBuffer)] = receivedChar;
-                        dateAndTimerInputBuffer[strlen(dateAndTimerInputBuffer) + 1] = '\0';
-                    }
-
-                    // Verifica si se han ingresado dos dígitos y están en el rango correcto
-                    if (strlen(dateAndTimerInputBuffer) == 2) {
-                        int monthValue = atoi(dateAndTimerInputBuffer);
-                        if (monthValue >= 1 && monthValue <= 12) {
-                            // El mes se ha ingresado correctamente
-                            // Cambia al siguiente estado
-                            dateAndTimeInputState = DATE_AND_TIME_READ_DAY;
-                            pcSerialComStringWrite("\r\nType two digits for the current day (01-31): ");
-                            // Limpia el búfer de entrada para el próximo campo
-                            dateAndTimerInputBuffer[0] = '\0';
-                        } else {
-                            // El mes está fuera del rango, muestra un mensaje de error
-                            pcSerialComStringWrite("\r\nInvalid month. Please try again (01-12): ");
-                            // Limpia el búfer de entrada para volver a ingresar el mes
-                            dateAndTimerInputBuffer[0] = '\0';
-                        }
-                    }
-                } else {
-                    // El caracter no es un dígito válido, muestra un mensaje de error
-                    pcSerialComStringWrite("\r\nInvalid input. Please try again (01-12): ");
-                    // Limpia el búfer de entrada para volver a ingresar el mes
-                    dateAndTimerInputBuffer[0] = '\0';
-                }
-                break;
-            case DATE_AND_TIME_READ_DAY:
-                // Verifica si el caracter recibido es un dígito válido
-                if (isdigit(receivedChar)) {
-                    // Agrega el caracter al búfer de entrada si hay espacio
-                    if (strlen(dateAndTimerInputBuffer) < 2) {
-                        dateAndTimerInputBuffer[strlen(dateAndTimerInputBuffer)] = receivedChar;
-                        dateAndTimerInputBuffer[strlen(dateAndTimerInputBuffer) + 1] = '\0';
-                    }
-
-                    // Verifica si se han ingresado dos dígitos y si están en el rango correcto
-                    if (strlen(dateAndTimerInputBuffer) == 2) {
-                        int dayValue = atoi(dateAndTimerInputBuffer);
-                        if (dayValue >= 1 && dayValue <= 31) {
-                            // El día se ha ingresado correctamente
-                            // Cambia al siguiente estado
-                            dateAndTimeInputState = DATE_AND_TIME_READ_HOUR;
-                            pcSerialComStringWrite("\r\nType two digits for the current hour (00-23): ");
-                            // Limpia el búfer de entrada para el próximo campo
-                            dateAndTimerInputBuffer[0] = '\0';
-                        } else {
-                            // El día está fuera del rango, muestra un mensaje de error
-                            pcSerialComStringWrite("\r\nInvalid day. Please try again (01-31): ");
-                            // Limpia el búfer de entrada para volver a ingresar el día
-                            dateAndTimerInputBuffer[0] = '\0';
-                        }
-                    }
-                } else {
-                    // El caracter no es un dígito válido, muestra un mensaje de error
-                    pcSerialComStringWrite("\r\nInvalid input. Please try again (01-31): ");
-                    // Limpia el búfer de entrada para volver a ingresar el día
-                    dateAndTimerInputBuffer[0] = '\0';
-                }
-                break;
-            case DATE_AND_TIME_READ_HOUR:
-                // Verifica si el caracter recibido es un dígito válido
-                if (isdigit(receivedChar)) {
-                    // Agrega el caracter al búfer de entrada si hay espacio
-                    if (strlen(dateAndTimerInputBuffer) < 2) {
-                        dateAndTimerInputBuffer[strlen(dateAndTimerInputBuffer)] = receivedChar;
-                        dateAndTimerInputBuffer[strlen(dateAndTimerInputBuffer) + 1] = '\0';
-                    }
-
-                    // Verifica si se han ingresado dos dígitos y si están en el rango correcto
-                    if (strlen(dateAndTimerInputBuffer) == 2) {
-                        int hourValue = atoi(dateAndTimerInputBuffer);
-                        if (hourValue >= 0 && hourValue <= 23) {
-                            // La hora se ha ingresado correctamente
-                            // Cambia al siguiente estado
-                            dateAndTimeInputState = DATE_AND_TIME_READ_MINUTE;
-                            pcSerialComStringWrite("\r\nType two digits for the current minutes (00-59): ");
-                            // Limpia el búfer de entrada para el próximo campo
-                            dateAndTimerInputBuffer[0] = '\0';
-                        } else {
-                            // La hora está fuera del rango, muestra un mensaje de error
-                            pcSerialComStringWrite("\r\nInvalid hour. Please try again (00-23): ");
-                            // Limpia el búfer de entrada para volver a ingresar la hora
-                            dateAndTimerInputBuffer[0] = '\0';
-                        }
-                    }
-                } else {
-                    // El caracter no es un dígito válido, muestra un mensaje de error
-                    pcSerialComStringWrite("\r\nInvalid input. Please try again (00-23): ");
-                    // Limpia el búfer de entrada para volver a ingresar la hora
-                    dateAndTimerInputBuffer[0] = '\0';
-                }
-                break;
-
-            case DATE_AND_TIME_READ_MINUTE:
-                // Verifica si el caracter recibido es un dígito válido
-                if (isdigit(receivedChar)) {
-                    // Agrega el caracter al búfer de entrada si hay espacio
-                    if (strlen(dateAndTimerInputBuffer) < 2) {
-                        dateAndTimerInputBuffer[strlen(dateAndTimerInputBuffer)] = receivedChar;
-                        dateAndTimerInputBuffer[strlen(dateAndTimerInputBuffer) + 1] = '\0';
-                    }
-
-                    // Verifica si se han ingresado dos dígitos y si están en el rango correcto
-                    if (strlen(dateAndTimerInputBuffer) == 2) {
-                        int minuteValue = atoi(dateAndTimerInputBuffer);
-                        if (minuteValue >= 0 && minuteValue <= 59) {
-                            // Los minutos se han ingresado correctamente
-                            // Cambia al siguiente estado
-                            dateAndTimeInputState = DATE_AND_TIME_READ_SECOND;
-                            pcSerialComStringWrite("\r\nType two digits for the current seconds (00-59): ");
-                            // Limpia el búfer de entrada para el próximo campo
-                            dateAndTimerInputBuffer[0] = '\0';
-                        } else {
-                            // Los minutos están fuera del rango, muestra un mensaje de error
-                            pcSerialComStringWrite("\r\nInvalid minutes. Please try again (00-59): ");
-                            // Limpia el búfer de entrada para volver a ingresar los minutos
-                            dateAndTimerInputBuffer[0] = '\0';
-                        }
-                    }
-                } else {
-                    // El caracter no es un dígito válido, muestra un mensaje de error
-                    pcSerialComStringWrite("\r\nInvalid input. Please try again (00-59): ");
-                    // Limpia el búfer de entrada para volver a ingresar los minutos
-                    dateAndTimerInputBuffer[0] = '\0';
-                }
-                break;
-            case DATE_AND_TIME_READ_SECOND:
-                // Verifica si el caracter recibido es un dígito válido
-                if (isdigit(receivedChar)) {
-                    // Agrega el caracter al búfer de entrada si hay espacio
-                    if (strlen(dateAndTimerInputBuffer) < 2) {
-                        dateAndTimerInputBuffer[strlen(dateAndTimerInputBuffer)] = receivedChar;
-                        dateAndTimerInputBuffer[strlen(dateAndTimerInputBuffer) + 1] = '\0';
-                    }
-
-                    // Verifica si se han ingresado dos dígitos y si están en el rango correcto
-                    if (strlen(dateAndTimerInputBuffer) == 2) {
-                        int secondValue = atoi(dateAndTimerInputBuffer);
-                        if (secondValue >= 0 && secondValue <= 59) {
-                            // Los segundos se han ingresado correctamente
-                            // Cambia al estado final o realiza la acción necesaria
-                            // aquí puedes usar los valores de año, mes, día, hora, minuto y segundo
-                            // para configurar la fecha y hora
-                            pcSerialComStringWrite("\r\nDate and time has been set\r\n");
-                            dateAndTimeWrite(atoi(yearBuffer), atoi(monthBuffer), atoi(dayBuffer),
-                                            atoi(hourBuffer), atoi(minuteBuffer), secondValue);
-                            dateAndTimeInputState = DATE_AND_TIME_DONE; // Cambia al estado final
-                        } else {
-                            // Los segundos están fuera del rango, muestra un mensaje de error
-                            pcSerialComStringWrite("\r\nInvalid seconds. Please try again (00-59): ");
-                            // Limpia el búfer de entrada para volver a ingresar los segundos
-                            dateAndTimerInputBuffer[0] = '\0';
-                        }
-                    }
-                } else {
-                    // El caracter no es un dígito válido, muestra un mensaje de error
-                    pcSerialComStringWrite("\r\nInvalid input. Please try again (00-59): ");
-                    // Limpia el búfer de entrada para volver a ingresar los segundos
-                    dateAndTimerInputBuffer[0] = '\0';
-                }
-                break;
-                
+// The check is done with interrupts masked so the ISR cannot disable itself
+// between the test and the enable, stranding queued bytes
+static void pcSerialComTxStart( pcSerialComSession_t* session )
+{
+    core_util_critical_section_enter();
+    if ( !session->txInterruptEnabled &&
+         pcSerialComTxSourceSelect( session ) != PC_SERIAL_TX_NONE ) {
+        session->txInterruptEnabled = true;
+        session->uart->attach( callback( &pcSerialComTxIsr, session ),
+                               SerialBase::TxIrq );
+    }
+    core_util_critical_section_exit();
+}
+
+static void pcSerialComTxStop( pcSerialComSession_t* session )
+{
+    session->uart->attach( nullptr, SerialBase::TxIrq );
+    session->txInterruptEnabled = false;
+}
+
+static bool pcSerialComBulkStart( pcSerialComSession_t* session,
+                                  const pcSerialComChunk_t* chunks,
+                                  int numberOfChunks,
+                                  pcSerialComBulkDoneCallback_t onDone,
+                                  bool binary )
+{
+    if ( numberOfChunks <= 0 || session->bulkState != PC_SERIAL_BULK_IDLE ) {
+        return false;
+    }
+    session->bulkChunks = chunks;
+    session->bulkNumberOfChunks = numberOfChunks;
+    session->bulkDoneCallback = onDone;
+    session->bulkBinary = binary;
+    session->bulkTxMark = session->txQueue.writeCount();
+    session->bulkState = PC_SERIAL_BULK_PENDING;
+    session->stats.bulkTransfers++;
+    pcSerialComTxStart( session );
+    return true;
+}
+
+static void pcSerialComBulkBegin( pcSerialComSession_t* session )
+{
+    session->bulkChunkIndex = 0;
+    session->bulkByteIndex = 0;
+    session->bulkState = PC_SERIAL_BULK_ACTIVE;
+}
+
+// One byte per TX interrupt, read in place from the chunk
+static void pcSerialComBulkPutNextByte( pcSerialComSession_t* session )
+{
+    const pcSerialComChunk_t* chunk =
+        &session->bulkChunks[session->bulkChunkIndex];
+    if ( session->bulkByteIndex < chunk->length ) {
+        char c = chunk->data[session->bulkByteIndex];
+        session->uart->putc( c );
+        session->normalAtLineStart = !session->bulkBinary && ( c == '\n' );
+        pcSerialComBulkAdvance( session, 1 );
+    } else {
+        pcSerialComBulkAdvance( session, 0 );
+    }
+}
+
+// Moves past bytes sent from the current chunk, and on to the next chunk
+// once it has all gone (or at once for an empty one)
+static void pcSerialComBulkAdvance( pcSerialComSession_t* session,
+                                    int numberOfBytes )
+{
+    const pcSerialComChunk_t* chunk =
+        &session->bulkChunks[session->bulkChunkIndex];
+
+    session->bulkByteIndex += numberOfBytes;
+    session->stats.txBytes += numberOfBytes;
+    metricsCounterAdd( METRICS_COUNTER_SERIAL_TX_BYTES, numberOfBytes );
+    if ( session->bulkByteIndex >= chunk->length ) {
+        session->bulkByteIndex = 0;
+        session->bulkChunkIndex++;
+        if ( session->bulkChunkIndex >= session->bulkNumberOfChunks ) {
+            pcSerialComBulkFinish( session );
+        }
+    }
+}
+
+#if SERIAL_TX_DMA_ENABLED
+// Hands the rest of the chunk to the DMA, or for text the rest of its
+// current line, and silences the TX interrupt until the segment is out
+static void pcSerialComBulkDmaStart( pcSerialComSession_t* session )
+{
+    const pcSerialComChunk_t* chunk =
+        &session->bulkChunks[session->bulkChunkIndex];
+    const char* segment = chunk->data + session->bulkByteIndex;
+    int length = chunk->length - session->bulkByteIndex;
+    const char* lineEnd;
+
+    if ( length <= 0 ) {
+        pcSerialComBulkAdvance( session, 0 );
+        return;
+    }
+    if ( !session->bulkBinary ) {
+        lineEnd = (const char*)memchr( segment, '\n', length );
+        if ( lineEnd != nullptr ) {
+            length = lineEnd - segment + 1;
+        }
+    }
+    if ( length > SERIAL_TX_DMA_MAX_LENGTH ) {
+        length = SERIAL_TX_DMA_MAX_LENGTH;
+    }
+    session->bulkDmaLength = length;
+    session->bulkDmaBusy = true;
+    pcSerialComTxStop( session );
+    serialTxDmaStart( segment, length );
+}
+
+// Runs in the DMA interrupt once a segment is out; the TX interrupt picks
+// the next source, a notification first if the segment ended a line
+static void pcSerialComBulkDmaDone( pcSerialComSession_t* session )
+{
+    const pcSerialComChunk_t* chunk =
+        &session->bulkChunks[session->bulkChunkIndex];
+    int length = session->bulkDmaLength;
+    char lastChar = chunk->data[session->bulkByteIndex + length - 1];
+
+    session->normalAtLineStart = !session->bulkBinary && ( lastChar == '\n' );
+    session->bulkDmaBusy = false;
+    pcSerialComBulkAdvance( session, length );
+    pcSerialComTxStart( session );
+}
+#endif
+
+// Runs in interrupt context, and so does the user callback
+static void pcSerialComBulkFinish( pcSerialComSession_t* session )
+{
+    pcSerialComBulkDoneCallback_t onDone = session->bulkDoneCallback;
+    if ( session->bulkBinary ) {
+        session->normalAtLineStart = true;
+    }
+    session->bulkState = PC_SERIAL_BULK_IDLE;
+    pcSerialComTxStart( session );
+    if ( onDone != nullptr ) {
+        onDone();
+    }
+}
+
+// Bulk path when free, TX ring otherwise (the chunks must be strings)
+static void pcSerialComChunksWrite( pcSerialComSession_t* session,
+                                    const pcSerialComChunk_t* chunks,
+                                    int numberOfChunks )
+{
+    if ( !pcSerialComBulkStart( session, chunks, numberOfChunks, nullptr,
+                                false ) ) {
+        int i;
+        for ( i = 0; i < numberOfChunks; i++ ) {
+            pcSerialComTxEnqueue( session, chunks[i].data );
+        }
+    }
+}
+
+static void pcSerialComEventsExportDone()
+{
+    eventsExportBusy = false;
+}
+
+// Runs the new flow up to its first wait
+static void pcSerialComFlowStart( pcSerialComSession_t* session,
+                                  pcSerialComFlow_t flow )
+{
+    session->flow = flow;
+    session->flowState.resumePoint = 0;
+    TRACE_BUFFER_WRITE( TRACE_EVENT_SERIAL_FLOW_BEGIN, session - sessions );
+    pcSerialComFlowResume( session );
+}
+
+static void pcSerialComFlowResume( pcSerialComSession_t* session )
+{
+    if ( session->flow( session ) == ASYNC_FLOW_DONE ) {
+        TRACE_BUFFER_WRITE( TRACE_EVENT_SERIAL_FLOW_END, session - sessions );
+        session->flow = nullptr;
+        session->tokenWidth = 1;
+    }
+}
+
+// Waits inside a flow for the next token, at most width characters long;
+// the token is in tokenBuffer and tokenLength when the flow carries on
+#define PC_SERIAL_COM_AWAIT_TOKEN( session, width )                          \
+    do {                                                                     \
+        (session)->tokenWidth = (width);                                     \
+        ASYNC_FLOW_YIELD_UNTIL( &(session)->flowState, (session)->tokenReady ); \
+    } while ( 0 )
+
+static asyncFlowStatus_t pcSerialComDateAndTimeFlow( pcSerialComSession_t* session )
+{
+    pcSerialComDateAndTimeFrame_t* frame = &session->flowFrame.dateAndTime;
+
+    ASYNC_FLOW_BEGIN( &session->flowState );
 
-            case DATE_AND_TIME_DONE:
-                // Ya hemos terminado, no hacemos nada más
-                break;
+    frame->error = PC_SERIAL_INPUT_OK;
+    frame->fieldIndex = 0;
+    while ( frame->fieldIndex < DATE_AND_TIME_NUMBER_OF_FIELDS ) {
+        pcSerialComDateAndTimeFieldPrompt( session, frame->fieldIndex,
+                                           frame->error );
+        PC_SERIAL_COM_AWAIT_TOKEN( session,
+            dateAndTimeFields[frame->fieldIndex].numberOfDigits );
+        frame->error = pcSerialComDateAndTimeFieldParse( session,
+            frame->fieldIndex, &frame->values[frame->fieldIndex] );
+        if ( frame->error == PC_SERIAL_INPUT_OK ) {
+            frame->fieldIndex++;
         }
     }
+
+    dateAndTimeWrite( frame->values[0], frame->values[1], frame->values[2],
+                      frame->values[3], frame->values[4], frame->values[5] );
+    pcSerialComTxEnqueue( session, "\r\nDate and time has been set\r\n" );
+
+    ASYNC_FLOW_END( &session->flowState );
 }
 
+// Asks for a field, or asks again after the given error
+static void pcSerialComDateAndTimeFieldPrompt( pcSerialComSession_t* session,
+                                               int fieldIndex,
+                                               pcSerialComInputError_t error )
+{
+    const dateAndTimeField_t* field = &dateAndTimeFields[fieldIndex];
+
+    switch ( error ) {
+        case PC_SERIAL_INPUT_NOT_A_NUMBER:
+            pcSerialComTxEnqueue( session, "\r\nInvalid input" );
+            pcSerialComTxEnqueue( session, ". Please try again (" );
+        break;
+
+        case PC_SERIAL_INPUT_OUT_OF_RANGE:
+            pcSerialComTxEnqueue( session, "\r\nInvalid " );
+            pcSerialComTxEnqueue( session, field->name );
+            pcSerialComTxEnqueue( session, ". Please try again (" );
+        break;
 
-static void pcSerialComGetCodeUpdate( char receivedChar )
+        case PC_SERIAL_INPUT_OK:
+        default:
+            pcSerialComTxEnqueue( session, "\r\nType " );
+            pcSerialComTxEnqueue( session, field->numberOfDigitsText );
+            pcSerialComTxEnqueue( session, " digits for the current " );
+            pcSerialComTxEnqueue( session, field->name );
+            pcSerialComTxEnqueue( session, " (" );
+        break;
+    }
+    pcSerialComTxEnqueue( session, field->range );
+    pcSerialComTxEnqueue( session, "): " );
+}
+
+static pcSerialComInputError_t pcSerialComDateAndTimeFieldParse(
+    pcSerialComSession_t* session, int fieldIndex, int* value )
 {
-    codeSequenceFromPcSerialCom[numberOfCodeChars] = receivedChar;
-    pcSerialComStringWrite( "*" );
-    numberOfCodeChars++;
-   if ( numberOfCodeChars >= CODE_NUMBER_OF_KEYS ) {
-        pcSerialComMode = PC_SERIAL_COMMANDS;
-        codeComplete = true;
-        numberOfCodeChars = 0;
-    } 
+    const dateAndTimeField_t* field = &dateAndTimeFields[fieldIndex];
+    int i;
+
+    *value = 0;
+    for ( i = 0; i < session->tokenLength; i++ ) {
+        if ( !isdigit( (unsigned char)session->tokenBuffer[i] ) ) {
+            return PC_SERIAL_INPUT_NOT_A_NUMBER;
+        }
+        *value = *value * 10 + ( session->tokenBuffer[i] - '0' );
+    }
+    if ( session->tokenLength != field->numberOfDigits ||
+         *value < field->minValue || *value > field->maxValue ) {
+        return PC_SERIAL_INPUT_OUT_OF_RANGE;
+    }
+    return PC_SERIAL_INPUT_OK;
 }
 
-static void pcSerialComSaveNewCodeUpdate( char receivedChar )
+static asyncFlowStatus_t pcSerialComGetCodeFlow( pcSerialComSession_t* session )
 {
-    static char newCodeSequence[CODE_NUMBER_OF_KEYS];
+    ASYNC_FLOW_BEGIN( &session->flowState );
+
+    pcSerialComTxEnqueue( session, "Please enter the six digits numeric code " );
+    pcSerialComTxEnqueue( session, "to deactivate the alarm: " );
+    session->codePending = false;
+
+    PC_SERIAL_COM_AWAIT_TOKEN( session, CODE_NUMBER_OF_KEYS );
+    pcSerialComCodeTokenCopy( session, session->code,
+                              session->tokenBuffer, session->tokenLength );
+    session->codePending = true;
 
-    newCodeSequence[numberOfCodeChars] = receivedChar;
-    pcSerialComStringWrite( "*" );
-    numberOfCodeChars++;
-    if ( numberOfCodeChars >= CODE_NUMBER_OF_KEYS ) {
-        pcSerialComMode = PC_SERIAL_COMMANDS;
-        numberOfCodeChars = 0;
-        codeWrite( newCodeSequence );
-        pcSerialComStringWrite( "\r\nNew code configured\r\n\r\n" );
-    } 
+    ASYNC_FLOW_END( &session->flowState );
 }
 
-static void pcSerialComCommandUpdate( char receivedChar )
+static asyncFlowStatus_t pcSerialComSaveNewCodeFlow( pcSerialComSession_t* session )
 {
+    char newCodeSequence[CODE_NUMBER_OF_KEYS];
+
+    ASYNC_FLOW_BEGIN( &session->flowState );
+
+    pcSerialComTxEnqueue( session, "Please enter the new six digits numeric code " );
+    pcSerialComTxEnqueue( session, "to deactivate the alarm: " );
+
+    PC_SERIAL_COM_AWAIT_TOKEN( session, CODE_NUMBER_OF_KEYS );
+    pcSerialComCodeTokenCopy( session, newCodeSequence,
+                              session->tokenBuffer, session->tokenLength );
+    if ( session->tokenLength != CODE_NUMBER_OF_KEYS ) {
+        pcSerialComTxEnqueue( session, "\r\nThe new code is too short\r\n\r\n" );
+    } else if ( !codeSequenceCheck( newCodeSequence ) ) {
+        pcSerialComTxEnqueue( session, "\r\nThe new code must be digits only\r\n\r\n" );
+    } else if ( userCodesFind( newCodeSequence ) != USER_CODES_NO_USER ) {
+        pcSerialComTxEnqueue( session, "\r\nThe new code is already in use\r\n\r\n" );
+    } else if ( parametersCodeWrite( newCodeSequence ) ) {
+        pcSerialComTxEnqueue( session, "\r\nNew code configured\r\n\r\n" );
+    } else {
+        pcSerialComTxEnqueue( session, "\r\nNew code configured but not stored\r\n\r\n" );
+    }
+
+    ASYNC_FLOW_END( &session->flowState );
+}
+
+// Echoes one '*' per key; a code cut short by a line end is padded so it
+// can never match
+static void pcSerialComCodeTokenCopy( pcSerialComSession_t* session,
+                                      char* code, const char* token,
+                                      int length )
+{
+    int i;
+    for ( i = 0; i < CODE_NUMBER_OF_KEYS; i++ ) {
+        if ( i < length ) {
+            code[i] = token[i];
+            pcSerialComTxEnqueue( session, "*" );
+        } else {
+            code[i] = '\0';
+        }
+    }
+}
+
+static void pcSerialComCommandUpdate( pcSerialComSession_t* session,
+                                      char receivedChar )
+{
+    TRACE_BUFFER_WRITE( TRACE_EVENT_SERIAL_COMMAND,
+                        ( session - sessions ) << 8 | (uint8_t)receivedChar );
     switch (receivedChar) {
-        case '1': commandShowCurrentAlarmState(); break;
-        case '2': commandShowCurrentGasDetectorState(); break;
-        case '3': commandShowCurrentOverTemperatureDetectorState(); break;
-        case '4': commandEnterCodeSequence(); break;
-        case '5': commandEnterNewCode(); break;
-        case 'c': case 'C': commandShowCurrentTemperatureInCelsius(); break;
-        case 'f': case 'F': commandShowCurrentTemperatureInFahrenheit(); break;
-        case 's': case 'S': commandSetDateAndTime(); break;
-        case 't': case 'T': commandShowDateAndTime(); break;
-        case 'e': case 'E': commandShowStoredEvents(); break;
-        default: availableCommands(); break;
-    } 
-}
-
-static void availableCommands()
-{
-    pcSerialComStringWrite( "Available commands:\r\n" );
-    pcSerialComStringWrite( "Press '1' to get the alarm state\r\n" );
-    pcSerialComStringWrite( "Press '2' to get the gas detector state\r\n" );
-    pcSerialComStringWrite( "Press '3' to get the over temperature detector state\r\n" );
-    pcSerialComStringWrite( "Press '4' to enter the code to deactivate the alarm\r\n" );
-    pcSerialComStringWrite( "Press '5' to enter a new code to deactivate the alarm\r\n" );
-    pcSerialComStringWrite( "Press 'f' or 'F' to get lm35 reading in Fahrenheit\r\n" );
-    pcSerialComStringWrite( "Press 'c' or 'C' to get lm35 reading in Celsius\r\n" );
-    pcSerialComStringWrite( "Press 's' or 'S' to set the date and time\r\n" );
-    pcSerialComStringWrite( "Press 't' or 'T' to get the date and time\r\n" );
-    pcSerialComStringWrite( "Press 'e' or 'E' to get the stored events\r\n" );
-    pcSerialComStringWrite( "\r\n" );
-}
-
-static void commandShowCurrentAlarmState()
+        case '1': commandShowCurrentAlarmState( session ); break;
+        case '2': commandShowCurrentGasDetectorState( session ); break;
+        case '3': commandShowCurrentOverTemperatureDetectorState( session ); break;
+        case '4': commandEnterCodeSequence( session ); break;
+        case '5': commandEnterNewCode( session ); break;
+        case 'c': case 'C': commandShowCurrentTemperatureInCelsius( session ); break;
+        case 'f': case 'F': commandShowCurrentTemperatureInFahrenheit( session ); break;
+        case 's': case 'S': commandSetDateAndTime( session ); break;
+        case 't': case 'T': commandShowDateAndTime( session ); break;
+        case 'e': case 'E': commandShowStoredEvents( session ); break;
+        case 'q': case 'Q': commandShowSerialQueues( session ); break;
+        case 'p': case 'P': commandShowPowerStats( session ); break;
+        case 'w': case 'W': commandShowResetReason( session ); break;
+        case 'x': case 'X': commandDumpTraceBuffer( session ); break;
+        case 'm': case 'M': commandShowMetrics( session ); break;
+        default: availableCommands( session ); break;
+    }
+}
+
+static void availableCommands( pcSerialComSession_t* session )
+{
+    pcSerialComChunksWrite( session, availableCommandsChunks,
+                            sizeof(availableCommandsChunks) /
+                            sizeof(availableCommandsChunks[0]) );
+}
+
+static void commandShowCurrentAlarmState( pcSerialComSession_t* session )
 {
     if ( sirenStateRead() ) {
-        pcSerialComStringWrite( "The alarm is activated\r\n");
+        pcSerialComTxEnqueue( session, "The alarm is activated\r\n");
     } else {
-        pcSerialComStringWrite( "The alarm is not activated\r\n");
+        pcSerialComTxEnqueue( session, "The alarm is not activated\r\n");
     }
 }
 
-static void commandShowCurrentGasDetectorState()
+static void commandShowCurrentGasDetectorState( pcSerialComSession_t* session )
 {
     if ( gasDetectorStateRead() ) {
-        pcSerialComStringWrite( "Gas is being detected\r\n");
+        pcSerialComTxEnqueue( session, "Gas is being detected\r\n");
     } else {
-        pcSerialComStringWrite( "Gas is not being detected\r\n");
-    }    
+        pcSerialComTxEnqueue( session, "Gas is not being detected\r\n");
+    }
 }
 
-static void commandShowCurrentOverTemperatureDetectorState()
+static void commandShowCurrentOverTemperatureDetectorState( pcSerialComSession_t* session )
 {
     if ( overTemperatureDetectorStateRead() ) {
-        pcSerialComStringWrite( "Temperature is above the maximum level\r\n");
+        pcSerialComTxEnqueue( session, "Temperature is above the maximum level\r\n");
     } else {
-        pcSerialComStringWrite( "Temperature is below the maximum level\r\n");
+        pcSerialComTxEnqueue( session, "Temperature is below the maximum level\r\n");
     }
 }
 
-static void commandEnterCodeSequence()
+static void commandEnterCodeSequence( pcSerialComSession_t* session )
 {
     if( sirenStateRead() ) {
-        pcSerialComStringWrite( "Please enter the four digits numeric code " );
-        pcSerialComStringWrite( "to deactivate the alarm: " );
-        pcSerialComMode = PC_SERIAL_GET_CODE;
-        codeComplete = false;
-        numberOfCodeChars = 0;
+        pcSerialComFlowStart( session, &pcSerialComGetCodeFlow );
     } else {
-        pcSerialComStringWrite( "Alarm is not activated.\r\n" );
+        pcSerialComTxEnqueue( session, "Alarm is not activated.\r\n" );
     }
 }
 
-static void commandEnterNewCode()
+static void commandEnterNewCode( pcSerialComSession_t* session )
 {
-    pcSerialComStringWrite( "Please enter the new four digits numeric code " );
-    pcSerialComStringWrite( "to deactivate the alarm: " );
-    numberOfCodeChars = 0;
-    pcSerialComMode = PC_SERIAL_SAVE_NEW_CODE;
-
+    pcSerialComFlowStart( session, &pcSerialComSaveNewCodeFlow );
 }
 
-static void commandShowCurrentTemperatureInCelsius()
+static void commandShowCurrentTemperatureInCelsius( pcSerialComSession_t* session )
 {
     char str[100] = "";
-    sprintf ( str, "Temperature: %.2f \xB0 C\r\n",
-                    temperatureSensorReadCelsius() );
-    pcSerialComStringWrite( str );  
+    char* end = textFormatString( str, "Temperature: " );
+    end = textFormatFloat( end, temperatureSensorReadCelsius(), 2 );
+    textFormatString( end, " \xB0 C\r\n" );
+    pcSerialComTxEnqueue( session, str );
 }
 
-static void commandShowCurrentTemperatureInFahrenheit()
+static void commandShowCurrentTemperatureInFahrenheit( pcSerialComSession_t* session )
 {
     char str[100] = "";
-    sprintf ( str, "Temperature: %.2f \xB0 C\r\n",
-                    temperatureSensorReadFahrenheit() );
-    pcSerialComStringWrite( str );  
+    char* end = textFormatString( str, "Temperature: " );
+    end = textFormatFloat( end, temperatureSensorReadFahrenheit(), 2 );
+    textFormatString( end, " \xB0 F\r\n" );
+    pcSerialComTxEnqueue( session, str );
 }
 
-static void commandSetDateAndTime()
+static void commandSetDateAndTime( pcSerialComSession_t* session )
 {
-    pcSerialComMode = PC_SERIAL_SAVE_NEW_CODE;
-    dateAndTimerInputBuffer[0] = '\0';
-
-    dateAndTimeInputState = DATE_AND_TIME_START;
-    pcSerialComStringWrite("\r\n");
+    pcSerialComFlowStart( session, &pcSerialComDateAndTimeFlow );
 }
 
-static void commandShowDateAndTime()
+static void commandShowDateAndTime( pcSerialComSession_t* session )
 {
-    char str[100] = "";
-    sprintf ( str, "Date and Time = %s", dateAndTimeRead() );
-    pcSerialComStringWrite( str );
-    pcSerialComStringWrite("\r\n");
+    char str[DATE_AND_TIME_TEXT_LENGTH + 1];
+
+    dateAndTimeRead( str );
+    pcSerialComTxEnqueue( session, "Date and Time = " );
+    pcSerialComTxEnqueue( session, str );
+    pcSerialComTxEnqueue( session, "\r\n");
 }
 
-static void commandShowStoredEvents()
+static void commandShowStoredEvents( pcSerialComSession_t* session )
 {
     char str[EVENT_STR_LENGTH] = "";
     int i;
+
+    if ( eventsExportBusy || session->bulkState != PC_SERIAL_BULK_IDLE ||
+         eventLogNumberOfStoredEvents() == 0 ) {
+        for (i = 0; i < eventLogNumberOfStoredEvents(); i++) {
+            eventLogRead( i, str );
+            pcSerialComTxEnqueue( session, str );
+            pcSerialComTxEnqueue( session, "\r\n" );
+        }
+        return;
+    }
+
+    // The export buffer is not touched again until the transfer is over
+    eventsExportBusy = true;
     for (i = 0; i < eventLogNumberOfStoredEvents(); i++) {
-        eventLogRead( i, str );
-        pcSerialComStringWrite( str );   
-        pcSerialComStringWrite( "\r\n" );                    
+        eventLogRead( i, eventsExportBuffer[i] );
+        strcat( eventsExportBuffer[i], "\r\n" );
+        eventsExportChunks[i].data = eventsExportBuffer[i];
+        eventsExportChunks[i].length = strlen( eventsExportBuffer[i] );
+    }
+    pcSerialComBulkStart( session, eventsExportChunks, i,
+                          &pcSerialComEventsExportDone, false );
+}
+
+static void commandShowSerialQueues( pcSerialComSession_t* session )
+{
+    static const char* const sessionNames[PC_SERIAL_COM_NUMBER_OF_SESSIONS] = {
+        "USB", "AUX",
+    };
+    char str[200] = "";
+    char* end;
+    int i;
+
+    for ( i = 0; i < PC_SERIAL_COM_NUMBER_OF_SESSIONS; i++ ) {
+        pcSerialComSession_t* shown = &sessions[i];
+        end = textFormatString( str, sessionNames[i] );
+        end = textFormatString( end, ": queued " );
+        end = textFormatInt( end, pcSerialComTxPending( shown ) );
+        end = textFormatString( end, "/" );
+        end = textFormatInt( end, PC_SERIAL_COM_TX_BUFFER_SIZE );
+        end = textFormatString( end, " high " );
+        end = textFormatInt( end, pcSerialComTxHighPending( shown ) );
+        end = textFormatString( end, "/" );
+        end = textFormatInt( end, PC_SERIAL_COM_TX_HIGH_BUFFER_SIZE );
+        end = textFormatString( end, " bytes, dropped tx " );
+        end = textFormatUnsigned( end, shown->stats.txDroppedBytes );
+        end = textFormatString( end, " high " );
+        end = textFormatUnsigned( end, shown->stats.txHighDroppedBytes );
+        end = textFormatString( end, " rx " );
+        end = textFormatUnsigned( end, shown->stats.rxDroppedBytes );
+        textFormatString( end, "\r\n" );
+        pcSerialComTxEnqueue( session, str );
     }
-}
\ No newline at end of file
+}
+
+static void commandShowPowerStats( pcSerialComSession_t* session )
+{
+    static const char* const stateNames[POWER_MANAGER_NUMBER_OF_STATES] = {
+        "Running", "Tick sleep", "Standby",
+    };
+    powerManagerStats_t stats;
+    char str[100] = "";
+    char* end;
+    int i;
+
+    powerManagerStatsRead( &stats );
+    for ( i = 0; i < POWER_MANAGER_NUMBER_OF_STATES; i++ ) {
+        end = textFormatString( str, stateNames[i] );
+        end = textFormatString( end, ": " );
+        end = textFormatUint64( end, stats.stateTime_us[i] / 1000 );
+        textFormatString( end, " ms\r\n" );
+        pcSerialComTxEnqueue( session, str );
+    }
+    end = textFormatString( str, "Tick sleeps: " );
+    end = textFormatUnsigned( end, stats.tickSleeps );
+    end = textFormatString( end, ", standbys: " );
+    end = textFormatUnsigned( end, stats.standbys );
+    end = textFormatString( end, " (woken by an event " );
+    end = textFormatUnsigned( end, stats.eventWakeUps );
+    end = textFormatString( end, ", at the deadline " );
+    end = textFormatUnsigned( end, stats.deadlineWakeUps );
+    textFormatString( end, ")\r\n" );
+    pcSerialComTxEnqueue( session, str );
+}
+
+static void commandShowResetReason( pcSerialComSession_t* session )
+{
+    char str[SYSTEM_WATCHDOG_REPORT_STR_LENGTH];
+
+    systemWatchdogResetReportRead( str );
+    pcSerialComTxEnqueue( session, str );
+}
+
+// Binary, for tools/trace_to_chrome.py: capture the raw output to a file
+static void commandDumpTraceBuffer( pcSerialComSession_t* session )
+{
+    if ( !TRACE_BUFFER_ENABLED ) {
+        pcSerialComTxEnqueue( session, "Tracing is not enabled in this build\r\n" );
+    } else if ( !traceBufferDump( session - sessions ) ) {
+        pcSerialComTxEnqueue( session, "A transfer is in progress, try again later\r\n" );
+    }
+}
+
+static void commandShowMetrics( pcSerialComSession_t* session )
+{
+    char str[METRICS_STR_LENGTH] = "";
+    int i;
+
+    for ( i = 0; i < METRICS_NUMBER_OF_METRICS; i++ ) {
+        metricsTextWrite( str, i );
+        pcSerialComTxEnqueue( session, str );
+    }
+}
@@ -3,18 +3,68 @@
 #ifndef _PC_SERIAL_COM_H_
 #define _PC_SERIAL_COM_H_
 
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
 //=====[Declaration of public defines]=========================================
 
 //=====[Declaration of public data types]======================================
 
+typedef enum{
+    PC_SERIAL_COM_SESSION_USB,
+    PC_SERIAL_COM_SESSION_AUX,
+    PC_SERIAL_COM_NUMBER_OF_SESSIONS,
+} pcSerialComSessionId_t;
+
+typedef struct pcSerialComStats {
+    uint32_t rxBytes;
+    uint32_t rxDroppedBytes;
+    uint32_t txBytes;
+    uint32_t txDroppedBytes;
+    uint32_t txHighDroppedBytes;
+    uint32_t bulkTransfers;
+} pcSerialComStats_t;
+
+// One piece of a bulk transfer; data must stay valid until it completes.
+// The USB console reads it by DMA, so it must not be in the CCM RAM.
+typedef struct pcSerialComChunk {
+    const char* data;
+    int length;
+} pcSerialComChunk_t;
+
+// Called from interrupt context once the last chunk has been sent
+typedef void (*pcSerialComBulkDoneCallback_t)();
+
 //=====[Declarations (prototypes) of public functions]=========================
 
 void pcSerialComInit();
-char pcSerialComCharRead();
-void pcSerialComStringWrite( const char* str );
 void pcSerialComUpdate();
+void pcSerialComStringWrite( const char* str );
+void pcSerialComNotificationWrite( const char* str );
+void pcSerialComSessionStringWrite( pcSerialComSessionId_t sessionId,
+                                    const char* str );
+bool pcSerialComSessionFrameWrite( pcSerialComSessionId_t sessionId,
+                                   const char* frame );
+void pcSerialComCodeReplyWrite( const char* str );
 bool pcSerialComCodeCompleteRead();
 void pcSerialComCodeCompleteWrite( bool state );
+void pcSerialComStatsRead( pcSerialComSessionId_t sessionId,
+                           pcSerialComStats_t* stats );
+int pcSerialComTxPendingRead( pcSerialComSessionId_t sessionId );
+int pcSerialComTxHighPendingRead( pcSerialComSessionId_t sessionId );
+bool pcSerialComBulkWrite( pcSerialComSessionId_t sessionId,
+                          const pcSerialComChunk_t* chunks,
+                          int numberOfChunks,
+                          pcSerialComBulkDoneCallback_t onDone );
+bool pcSerialComBulkBinaryWrite( pcSerialComSessionId_t sessionId,
+                                 const pcSerialComChunk_t* chunks,
+                                 int numberOfChunks,
+                                 pcSerialComBulkDoneCallback_t onDone );
+bool pcSerialComBulkBusyRead( pcSerialComSessionId_t sessionId );
+bool pcSerialComIdleRead();
+void pcSerialComStandbyEnter();
+void pcSerialComStandbyExit();
 
 //=====[#include guards - end]=================================================
 
@@ -0,0 +1,114 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "power_manager.h"
+
+#include "date_and_time.h"
+#include "trace_buffer.h"
+#include "metrics.h"
+
+//=====[Declaration of private defines]========================================
+
+#define POWER_MANAGER_WAKE_UP_FLAG    (1 << 0)
+
+//=====[Declaration of private data types]=====================================
+
+//=====[Declaration and initialization of public global objects]===============
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+//=====[Declaration and initialization of private global variables]============
+
+static osThreadId_t superloopThreadId = nullptr;
+static powerManagerStats_t powerManagerStats;
+static uint64_t lastWakeUp_us = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void powerManagerStateTimeAdd( powerManagerState_t state,
+                                      uint64_t from_us, uint64_t to_us );
+
+//=====[Implementations of public functions]===================================
+
+// Must be called from the thread running the superloop
+void powerManagerInit()
+{
+    superloopThreadId = ThisThread::get_id();
+    lastWakeUp_us = dateAndTimeMonotonicRead();
+}
+
+// Ends a standby early. Safe from interrupts; does nothing to a tick sleep.
+void powerManagerWakeUp()
+{
+    if ( superloopThreadId != nullptr ) {
+        osThreadFlagsSet( superloopThreadId, POWER_MANAGER_WAKE_UP_FLAG );
+    }
+}
+
+// A fixed sleep between ticks: the modules count SYSTEM_TIME_INCREMENT_MS
+// per update, so it is never cut short. Wake-ups that arrive meanwhile are
+// handled by the next update anyway and are discarded.
+void powerManagerTickSleep( int sleepTime_ms )
+{
+    uint64_t sleepStart_us = dateAndTimeMonotonicRead();
+
+    powerManagerStateTimeAdd( POWER_MANAGER_RUN, lastWakeUp_us, sleepStart_us );
+    ThisThread::sleep_for( Kernel::Clock::duration_u32( sleepTime_ms ) );
+    ThisThread::flags_clear( POWER_MANAGER_WAKE_UP_FLAG );
+    lastWakeUp_us = dateAndTimeMonotonicRead();
+    powerManagerStateTimeAdd( POWER_MANAGER_TICK_SLEEP,
+                              sleepStart_us, lastWakeUp_us );
+    powerManagerStats.tickSleeps++;
+}
+
+// Sleeps until the deadline or until powerManagerWakeUp(), whichever comes
+// first, and returns true in the second case. A wake-up raised after the
+// caller decided to stand by is not lost: it ends the standby at once.
+// With nothing holding the sleep manager's deep sleep lock the idle thread
+// stops the core: the monotonic clock and the watchdog supervision run on
+// the low power ticker, and the caller has detached the UARTs' RX
+// interrupts, leaving their RX pins to wake it. A character still being
+// transmitted or a Timeout still pending keep it in a plain sleep meanwhile.
+bool powerManagerStandby( int sleepTime_ms )
+{
+    uint64_t sleepStart_us = dateAndTimeMonotonicRead();
+    uint32_t flags;
+    bool wokenUp;
+
+    powerManagerStateTimeAdd( POWER_MANAGER_RUN, lastWakeUp_us, sleepStart_us );
+    TRACE_BUFFER_WRITE( TRACE_EVENT_STANDBY_BEGIN, 0 );
+    flags = ThisThread::flags_wait_any_for( POWER_MANAGER_WAKE_UP_FLAG,
+                Kernel::Clock::duration_u32( sleepTime_ms ) );
+    wokenUp = ( flags & POWER_MANAGER_WAKE_UP_FLAG ) != 0;
+    lastWakeUp_us = dateAndTimeMonotonicRead();
+    TRACE_BUFFER_WRITE( TRACE_EVENT_STANDBY_END, wokenUp );
+    TRACE_BUFFER_WRITE( TRACE_EVENT_TIME_SYNC, lastWakeUp_us );
+    powerManagerStateTimeAdd( POWER_MANAGER_STANDBY,
+                              sleepStart_us, lastWakeUp_us );
+    powerManagerStats.standbys++;
+    metricsHistogramRecord( METRICS_HISTOGRAM_STANDBY_TIME_MS,
+        (uint32_t)( ( lastWakeUp_us - sleepStart_us ) / 1000 ) );
+    if ( wokenUp ) {
+        powerManagerStats.eventWakeUps++;
+    } else {
+        powerManagerStats.deadlineWakeUps++;
+    }
+    return wokenUp;
+}
+
+void powerManagerStatsRead( powerManagerStats_t* stats )
+{
+    *stats = powerManagerStats;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void powerManagerStateTimeAdd( powerManagerState_t state,
+                                      uint64_t from_us, uint64_t to_us )
+{
+    powerManagerStats.stateTime_us[state] += to_us - from_us;
+}
@@ -0,0 +1,39 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _POWER_MANAGER_H_
+#define _POWER_MANAGER_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+//=====[Declaration of public data types]======================================
+
+typedef enum {
+    POWER_MANAGER_RUN,
+    POWER_MANAGER_TICK_SLEEP,
+    POWER_MANAGER_STANDBY,
+    POWER_MANAGER_NUMBER_OF_STATES,
+} powerManagerState_t;
+
+typedef struct powerManagerStats {
+    uint32_t tickSleeps;
+    uint32_t standbys;
+    uint32_t eventWakeUps;
+    uint32_t deadlineWakeUps;
+    uint64_t stateTime_us[POWER_MANAGER_NUMBER_OF_STATES];
+} powerManagerStats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void powerManagerInit();
+void powerManagerWakeUp();
+void powerManagerTickSleep( int sleepTime_ms );
+bool powerManagerStandby( int sleepTime_ms );
+void powerManagerStatsRead( powerManagerStats_t* stats );
+
+//=====[#include guards - end]=================================================
+
+#endif // _POWER_MANAGER_H_
@@ -0,0 +1,619 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "serial_protocol.h"
+
+#include "fire_alarm.h"
+#include "date_and_time.h"
+#include "telemetry.h"
+#include "code.h"
+#include "parameters.h"
+#include "user_codes.h"
+#include "pc_serial_com.h"
+#include "time_sync.h"
+#include "metrics.h"
+#include "text_format.h"
+
+//=====[Declaration of private defines]========================================
+
+#define SERIAL_PROTOCOL_CMD_MAX_LENGTH    16
+#define SERIAL_PROTOCOL_ERROR_MAX_LENGTH  40
+
+// Room kept for the ',"next":<n>}}' ending a metrics response
+#define SERIAL_PROTOCOL_METRICS_END_LENGTH  16
+
+//=====[Declaration of private data types]=====================================
+
+//=====[Declaration and initialization of public global objects]===============
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+//=====[Declaration and initialization of private global variables]============
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static const char* serialProtocolFieldFind( const char* request,
+                                            const char* key );
+static bool serialProtocolIntFieldRead( const char* request, const char* key,
+                                        long* value );
+static bool serialProtocolInt64FieldRead( const char* request,
+                                          const char* key, int64_t* value );
+static bool serialProtocolFloatFieldRead( const char* request,
+                                          const char* key, float* value );
+static bool serialProtocolStringFieldRead( const char* request,
+                                           const char* key,
+                                           char* value, int valueSize );
+
+static void serialProtocolStatusWrite( long id, char* response );
+static void serialProtocolSubscribe( int sessionId, const char* request,
+                                     long id, char* response );
+static void serialProtocolProvision( const char* request, long id,
+                                     char* response );
+static bool serialProtocolParameterFieldRead(
+    const char* request, const parameterDescriptor_t* descriptor,
+    parameters_t* parameters );
+static void serialProtocolParametersWrite( long id, char* response );
+static void serialProtocolUserAdd( const char* request, long id,
+                                   char* response );
+static void serialProtocolUserRemove( const char* request, long id,
+                                      char* response );
+static void serialProtocolUserCodesResultWrite( long id,
+                                                userCodesResult_t result,
+                                                char* response );
+static void serialProtocolUsersWrite( long id, char* response );
+static void serialProtocolTimeSync( int sessionId, const char* request,
+                                    uint64_t received_us, long id,
+                                    char* response );
+static void serialProtocolTimeStatusWrite( long id, char* response );
+static void serialProtocolMetricsWrite( const char* request, long id,
+                                        char* response );
+static void serialProtocolInvalidFieldWrite( long id, const char* key,
+                                             char* response );
+static void serialProtocolResultWrite( long id, bool ok, char* response );
+static void serialProtocolIdErrorWrite( long id, const char* error,
+                                        char* response );
+static char* serialProtocolHeaderWrite( long id, bool ok, char* response );
+static char* serialProtocolIntFieldWrite( char* str, const char* key,
+                                          long value );
+static char* serialProtocolUint64FieldWrite( char* str, const char* key,
+                                             uint64_t value );
+
+//=====[Implementations of public functions]===================================
+
+// Requests are JSON objects on a single line, for example
+// {"id":7,"cmd":"status"}. Every response echoes the id so that a host can
+// keep several requests in flight and match the answers. sessionId is the
+// console the request came from and received_us the monotonic time its line
+// end arrived.
+void serialProtocolRequestProcess( int sessionId, const char* request,
+                                   uint64_t received_us, char* response )
+{
+    long id = 0;
+    char cmd[SERIAL_PROTOCOL_CMD_MAX_LENGTH] = "";
+
+    if ( !serialProtocolIntFieldRead( request, "id", &id ) ) {
+        serialProtocolErrorWrite( "missing id", response );
+        return;
+    }
+    if ( !serialProtocolStringFieldRead( request, "cmd", cmd, sizeof(cmd) ) ) {
+        serialProtocolIdErrorWrite( id, "missing cmd", response );
+        return;
+    }
+
+    if ( strcmp( cmd, "status" ) == 0 ) {
+        serialProtocolStatusWrite( id, response );
+    } else if ( strcmp( cmd, "subscribe" ) == 0 ) {
+        serialProtocolSubscribe( sessionId, request, id, response );
+    } else if ( strcmp( cmd, "unsubscribe" ) == 0 ) {
+        telemetryUnsubscribe();
+        serialProtocolResultWrite( id, true, response );
+    } else if ( strcmp( cmd, "provision" ) == 0 ) {
+        serialProtocolProvision( request, id, response );
+    } else if ( strcmp( cmd, "params" ) == 0 ) {
+        serialProtocolParametersWrite( id, response );
+    } else if ( strcmp( cmd, "useradd" ) == 0 ) {
+        serialProtocolUserAdd( request, id, response );
+    } else if ( strcmp( cmd, "userdel" ) == 0 ) {
+        serialProtocolUserRemove( request, id, response );
+    } else if ( strcmp( cmd, "users" ) == 0 ) {
+        serialProtocolUsersWrite( id, response );
+    } else if ( strcmp( cmd, "timesync" ) == 0 ) {
+        serialProtocolTimeSync( sessionId, request, received_us, id,
+                                response );
+    } else if ( strcmp( cmd, "timestatus" ) == 0 ) {
+        serialProtocolTimeStatusWrite( id, response );
+    } else if ( strcmp( cmd, "metrics" ) == 0 ) {
+        serialProtocolMetricsWrite( request, id, response );
+    } else {
+        serialProtocolIdErrorWrite( id, "unknown cmd", response );
+    }
+}
+
+// For requests that could not be matched to an id
+void serialProtocolErrorWrite( const char* error, char* response )
+{
+    char* str = textFormatString( response, "{\"ok\":false,\"error\":\"" );
+    str = textFormatString( str, error );
+    textFormatString( str, "\"}" );
+}
+
+//=====[Implementations of private functions]==================================
+
+// Returns the first character of the value of "key", or nullptr
+static const char* serialProtocolFieldFind( const char* request,
+                                            const char* key )
+{
+    int keyLength = strlen( key );
+    const char* position = request;
+
+    while ( ( position = strchr( position, '"' ) ) != nullptr ) {
+        position++;
+        if ( strncmp( position, key, keyLength ) == 0 &&
+             position[keyLength] == '"' ) {
+            position = position + keyLength + 1;
+            while ( *position == ' ' ) {
+                position++;
+            }
+            if ( *position != ':' ) {
+                continue;
+            }
+            position++;
+            while ( *position == ' ' ) {
+                position++;
+            }
+            return position;
+        }
+    }
+    return nullptr;
+}
+
+static bool serialProtocolIntFieldRead( const char* request, const char* key,
+                                        long* value )
+{
+    const char* position = serialProtocolFieldFind( request, key );
+    char* end;
+
+    if ( position == nullptr ) {
+        return false;
+    }
+    *value = strtol( position, &end, 10 );
+    return end != position;
+}
+
+// For microsecond timestamps, which do not fit a long
+static bool serialProtocolInt64FieldRead( const char* request,
+                                          const char* key, int64_t* value )
+{
+    const char* position = serialProtocolFieldFind( request, key );
+    char* end;
+
+    if ( position == nullptr ) {
+        return false;
+    }
+    *value = strtoll( position, &end, 10 );
+    return end != position;
+}
+
+static bool serialProtocolFloatFieldRead( const char* request,
+                                          const char* key, float* value )
+{
+    const char* position = serialProtocolFieldFind( request, key );
+    char* end;
+
+    if ( position == nullptr ) {
+        return false;
+    }
+    *value = strtof( position, &end );
+    return end != position;
+}
+
+static bool serialProtocolStringFieldRead( const char* request,
+                                           const char* key,
+                                           char* value, int valueSize )
+{
+    const char* position = serialProtocolFieldFind( request, key );
+    int length = 0;
+
+    if ( position == nullptr || *position != '"' ) {
+        return false;
+    }
+    position++;
+    while ( position[length] != '"' ) {
+        if ( position[length] == '\0' || length >= valueSize - 1 ) {
+            return false;
+        }
+        value[length] = position[length];
+        length++;
+    }
+    value[length] = '\0';
+    return true;
+}
+
+// {"id":1,"cmd":"subscribe","period_ms":100,"batch":10}
+static void serialProtocolSubscribe( int sessionId, const char* request,
+                                     long id, char* response )
+{
+    long period_ms = 0;
+    long batchSize = 1;
+
+    if ( !serialProtocolIntFieldRead( request, "period_ms", &period_ms ) ) {
+        serialProtocolIdErrorWrite( id, "missing period_ms", response );
+        return;
+    }
+    serialProtocolIntFieldRead( request, "batch", &batchSize );
+    if ( !telemetrySubscribe( sessionId, period_ms, batchSize ) ) {
+        serialProtocolIdErrorWrite( id, "out of range", response );
+        return;
+    }
+    serialProtocolResultWrite( id, true, response );
+}
+
+// Commissioning in a single frame, for example
+// {"id":1,"cmd":"provision","time":1700000000,"code":"180524","tempLimitC":55,
+//  "strobeGas_ms":1000,"strobeOverTemp_ms":500,"strobeBoth_ms":100}
+// Apart from "time", the keys are the parameter names. Every field is
+// optional. All the fields given are checked first and the first invalid
+// one is reported; only when all are valid are they applied and stored, so
+// a rejected frame changes nothing. The error names the field, as in
+// {"id":1,"ok":false,"error":"invalid strobeGas_ms"}.
+static void serialProtocolProvision( const char* request, long id,
+                                     char* response )
+{
+    parameters_t parameters;
+    const parameterDescriptor_t* descriptor;
+    long epochSeconds = 0;
+    bool timeGiven;
+    int i;
+
+    parametersRead( &parameters );
+
+    timeGiven = serialProtocolFieldFind( request, "time" ) != nullptr;
+    if ( timeGiven &&
+         ( !serialProtocolIntFieldRead( request, "time", &epochSeconds ) ||
+           epochSeconds < DATE_AND_TIME_EPOCH_MIN ||
+           epochSeconds > DATE_AND_TIME_EPOCH_MAX ) ) {
+        serialProtocolInvalidFieldWrite( id, "time", response );
+        return;
+    }
+
+    for ( i = 0; i < parametersNumberOfDescriptorsRead(); i++ ) {
+        descriptor = parametersDescriptorRead( i );
+        if ( serialProtocolFieldFind( request, descriptor->name ) != nullptr &&
+             !serialProtocolParameterFieldRead( request, descriptor,
+                                                &parameters ) ) {
+            serialProtocolInvalidFieldWrite( id, descriptor->name, response );
+            return;
+        }
+    }
+    descriptor = parametersCheck( &parameters );
+    if ( descriptor != nullptr ) {
+        serialProtocolInvalidFieldWrite( id, descriptor->name, response );
+        return;
+    }
+
+    if ( timeGiven ) {
+        dateAndTimeEpochWrite( epochSeconds );
+    }
+    if ( !parametersWrite( &parameters ) ) {
+        serialProtocolIdErrorWrite( id, "applied but not stored", response );
+        return;
+    }
+    serialProtocolResultWrite( id, true, response );
+}
+
+// Parses the field named after the parameter into its place in parameters
+static bool serialProtocolParameterFieldRead(
+    const char* request, const parameterDescriptor_t* descriptor,
+    parameters_t* parameters )
+{
+    char* field = (char*)parameters + descriptor->offset;
+    char code[CODE_NUMBER_OF_KEYS + 1] = "";
+    long value;
+
+    switch ( descriptor->type ) {
+        case PARAMETER_TYPE_INT:
+            if ( !serialProtocolIntFieldRead( request, descriptor->name,
+                                              &value ) ) {
+                return false;
+            }
+            *(int32_t*)field = value;
+            return true;
+
+        case PARAMETER_TYPE_FLOAT:
+            return serialProtocolFloatFieldRead( request, descriptor->name,
+                                                 (float*)field );
+
+        case PARAMETER_TYPE_CODE:
+            if ( !serialProtocolStringFieldRead( request, descriptor->name,
+                                                 code, sizeof(code) ) ||
+                 strlen( code ) != CODE_NUMBER_OF_KEYS ) {
+                return false;
+            }
+            memcpy( field, code, CODE_NUMBER_OF_KEYS );
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+// {"id":1,"cmd":"params"} lists every parameter except the code
+static void serialProtocolParametersWrite( long id, char* response )
+{
+    parameters_t parameters;
+    const parameterDescriptor_t* descriptor;
+    const char* field;
+    char* str;
+    int i;
+
+    parametersRead( &parameters );
+
+    str = serialProtocolHeaderWrite( id, true, response );
+    str = serialProtocolIntFieldWrite( str, "version", PARAMETERS_VERSION );
+    str = serialProtocolIntFieldWrite( str, "stored", parametersStoredRead() );
+    for ( i = 0; i < parametersNumberOfDescriptorsRead(); i++ ) {
+        descriptor = parametersDescriptorRead( i );
+        field = (const char*)&parameters + descriptor->offset;
+        if ( descriptor->type == PARAMETER_TYPE_INT ) {
+            str = serialProtocolIntFieldWrite( str, descriptor->name,
+                                               *(const int32_t*)field );
+        } else if ( descriptor->type == PARAMETER_TYPE_FLOAT ) {
+            str = textFormatString( str, ",\"" );
+            str = textFormatString( str, descriptor->name );
+            str = textFormatString( str, "\":" );
+            str = textFormatFloat( str, *(const float*)field, 2 );
+        }
+    }
+    textFormatString( str, "}" );
+}
+
+// {"id":1,"cmd":"useradd","user":12,"code":"432107"} gives user 12 a code,
+// replacing the one it had
+static void serialProtocolUserAdd( const char* request, long id,
+                                   char* response )
+{
+    char code[CODE_NUMBER_OF_KEYS + 1] = "";
+    long userId;
+
+    if ( !serialProtocolIntFieldRead( request, "user", &userId ) ) {
+        serialProtocolInvalidFieldWrite( id, "user", response );
+        return;
+    }
+    if ( !serialProtocolStringFieldRead( request, "code", code, sizeof(code) ) ||
+         strlen( code ) != CODE_NUMBER_OF_KEYS ) {
+        serialProtocolInvalidFieldWrite( id, "code", response );
+        return;
+    }
+    serialProtocolUserCodesResultWrite( id, userCodesAdd( userId, code ),
+                                        response );
+}
+
+// {"id":1,"cmd":"userdel","user":12}
+static void serialProtocolUserRemove( const char* request, long id,
+                                      char* response )
+{
+    long userId;
+
+    if ( !serialProtocolIntFieldRead( request, "user", &userId ) ) {
+        serialProtocolInvalidFieldWrite( id, "user", response );
+        return;
+    }
+    serialProtocolUserCodesResultWrite( id, userCodesRemove( userId ),
+                                        response );
+}
+
+static void serialProtocolUserCodesResultWrite( long id,
+                                                userCodesResult_t result,
+                                                char* response )
+{
+    switch ( result ) {
+        case USER_CODES_OK:
+            serialProtocolResultWrite( id, true, response );
+        break;
+        case USER_CODES_CODE_IN_USE:
+            serialProtocolIdErrorWrite( id, "code in use", response );
+        break;
+        case USER_CODES_TABLE_FULL:
+            serialProtocolIdErrorWrite( id, "table full", response );
+        break;
+        case USER_CODES_UNKNOWN_USER:
+            serialProtocolIdErrorWrite( id, "unknown user", response );
+        break;
+        case USER_CODES_INVALID:
+        default:
+            serialProtocolIdErrorWrite( id, "invalid user or code", response );
+        break;
+    }
+}
+
+static void serialProtocolUsersWrite( long id, char* response )
+{
+    char* str = serialProtocolHeaderWrite( id, true, response );
+    str = serialProtocolIntFieldWrite( str, "users",
+                                       userCodesNumberOfUsersRead() );
+    str = serialProtocolIntFieldWrite( str, "maxUsers", USER_CODES_MAX_USERS );
+    str = serialProtocolIntFieldWrite( str, "stored", userCodesStoredRead() );
+    textFormatString( str, "}" );
+}
+
+// {"id":1,"cmd":"timesync","t1_us":1700000000123456,"prev_t4_us":0}
+// t1_us is the host clock when sending and prev_t4_us the host clock when
+// the answer to its previous timesync arrived, or 0 for the first one. The
+// answer carries t2_us, when the frame was received, and t3_us, when the
+// answer was built, both on the panel clock. Without a receive time t2_us
+// falls back to now, which then includes the time the frame was queued.
+static void serialProtocolTimeSync( int sessionId, const char* request,
+                                    uint64_t received_us, long id,
+                                    char* response )
+{
+    int64_t t1_us = 0;
+    int64_t previousT4_us = 0;
+    timeSyncStamps_t stamps;
+    timeSyncStatus_t status;
+    char* str;
+
+    if ( !serialProtocolInt64FieldRead( request, "t1_us", &t1_us ) ||
+         t1_us <= 0 ) {
+        serialProtocolInvalidFieldWrite( id, "t1_us", response );
+        return;
+    }
+    if ( serialProtocolFieldFind( request, "prev_t4_us" ) != nullptr &&
+         ( !serialProtocolInt64FieldRead( request, "prev_t4_us",
+                                          &previousT4_us ) ||
+           previousT4_us < 0 ) ) {
+        serialProtocolInvalidFieldWrite( id, "prev_t4_us", response );
+        return;
+    }
+
+    if ( received_us == SERIAL_PROTOCOL_NO_RECEIVE_TIME ) {
+        received_us = dateAndTimeMonotonicRead();
+    }
+    timeSyncExchange( sessionId, t1_us, previousT4_us, received_us, &stamps );
+    timeSyncStatusRead( &status );
+
+    str = serialProtocolHeaderWrite( id, true, response );
+    str = serialProtocolUint64FieldWrite( str, "t2_us", stamps.t2_us );
+    str = serialProtocolUint64FieldWrite( str, "t3_us", stamps.t3_us );
+    str = serialProtocolIntFieldWrite( str, "offset_us", status.lastOffset_us );
+    str = serialProtocolIntFieldWrite( str, "drift_ppb", status.rate_ppb );
+    textFormatString( str, "}" );
+}
+
+static void serialProtocolTimeStatusWrite( long id, char* response )
+{
+    timeSyncStatus_t status;
+    char* str;
+
+    timeSyncStatusRead( &status );
+
+    str = serialProtocolHeaderWrite( id, true, response );
+    str = serialProtocolIntFieldWrite( str, "synchronized", status.synchronized );
+    str = serialProtocolIntFieldWrite( str, "samples", status.samples );
+    str = serialProtocolIntFieldWrite( str, "rejected", status.rejectedSamples );
+    str = serialProtocolIntFieldWrite( str, "offset_us", status.lastOffset_us );
+    str = serialProtocolIntFieldWrite( str, "delay_us", status.lastDelay_us );
+    str = serialProtocolIntFieldWrite( str, "drift_ppb", status.rate_ppb );
+    str = serialProtocolUint64FieldWrite( str, "time_us",
+                                          dateAndTimeEpochUsRead() );
+    textFormatString( str, "}" );
+}
+
+// {"id":1,"cmd":"metrics","first":0} answers with as many metrics as fit
+// in a response, starting with number first, and with "next", the first
+// one left out, when some are. A host repeats the request from "next" until
+// it is missing.
+static void serialProtocolMetricsWrite( const char* request, long id,
+                                        char* response )
+{
+    char metric[METRICS_STR_LENGTH];
+    long first = 0;
+    int next;
+    char* str;
+
+    if ( serialProtocolFieldFind( request, "first" ) != nullptr &&
+         ( !serialProtocolIntFieldRead( request, "first", &first ) ||
+           first < 0 || first >= METRICS_NUMBER_OF_METRICS ) ) {
+        serialProtocolInvalidFieldWrite( id, "first", response );
+        return;
+    }
+
+    str = serialProtocolHeaderWrite( id, true, response );
+    str = textFormatString( str, ",\"metrics\":{" );
+    for ( next = first; next < METRICS_NUMBER_OF_METRICS; next++ ) {
+        int length = metricsJsonWrite( metric, next ) - metric + 1;
+        if ( ( str - response ) + length + SERIAL_PROTOCOL_METRICS_END_LENGTH >=
+             SERIAL_PROTOCOL_RESPONSE_MAX_LENGTH ) {
+            break;
+        }
+        if ( next > first ) {
+            str = textFormatString( str, "," );
+        }
+        str = textFormatString( str, metric );
+    }
+    str = textFormatString( str, "}" );
+    if ( next < METRICS_NUMBER_OF_METRICS ) {
+        str = serialProtocolIntFieldWrite( str, "next", next );
+    }
+    textFormatString( str, "}" );
+}
+
+static void serialProtocolInvalidFieldWrite( long id, const char* key,
+                                             char* response )
+{
+    char error[SERIAL_PROTOCOL_ERROR_MAX_LENGTH];
+    char* str = textFormatString( error, "invalid " );
+    textFormatString( str, key );
+    serialProtocolIdErrorWrite( id, error, response );
+}
+
+static void serialProtocolResultWrite( long id, bool ok, char* response )
+{
+    char* str = serialProtocolHeaderWrite( id, ok, response );
+    textFormatString( str, "}" );
+}
+
+static void serialProtocolIdErrorWrite( long id, const char* error,
+                                        char* response )
+{
+    char* str = serialProtocolHeaderWrite( id, false, response );
+    str = textFormatString( str, ",\"error\":\"" );
+    str = textFormatString( str, error );
+    textFormatString( str, "\"}" );
+}
+
+// Writes {"id":<id>,"ok":<ok> and leaves the object open
+static char* serialProtocolHeaderWrite( long id, bool ok, char* response )
+{
+    char* str = textFormatString( response, "{\"id\":" );
+    str = textFormatInt( str, id );
+    return textFormatString( str, ok ? ",\"ok\":true" : ",\"ok\":false" );
+}
+
+// Writes ,"<key>":<value>
+static char* serialProtocolIntFieldWrite( char* str, const char* key,
+                                          long value )
+{
+    str = textFormatString( str, ",\"" );
+    str = textFormatString( str, key );
+    str = textFormatString( str, "\":" );
+    return textFormatInt( str, value );
+}
+
+static char* serialProtocolUint64FieldWrite( char* str, const char* key,
+                                             uint64_t value )
+{
+    str = textFormatString( str, ",\"" );
+    str = textFormatString( str, key );
+    str = textFormatString( str, "\":" );
+    return textFormatUint64( str, value );
+}
+
+// Every field comes from the same alarm update, which "update" numbers
+static void serialProtocolStatusWrite( long id, char* response )
+{
+    fireAlarmSnapshot_t snapshot;
+    time_t epochSeconds;
+
+    fireAlarmSnapshotRead( &snapshot );
+    epochSeconds = dateAndTimeMonotonicToEpoch( snapshot.monotonic_us );
+
+    char* str = serialProtocolHeaderWrite( id, true, response );
+    str = serialProtocolIntFieldWrite( str, "alarm", snapshot.alarm );
+    str = serialProtocolIntFieldWrite( str, "gas", snapshot.gasDetector );
+    str = serialProtocolIntFieldWrite( str, "overTemp",
+                                       snapshot.overTemperatureDetector );
+    str = textFormatString( str, ",\"tempC\":" );
+    str = textFormatFloat( str, snapshot.temperatureC, 2 );
+    str = serialProtocolIntFieldWrite( str, "time", (long)epochSeconds );
+    str = serialProtocolIntFieldWrite( str, "blocked", snapshot.systemBlocked );
+    str = serialProtocolIntFieldWrite( str, "incorrectCode",
+                                       snapshot.incorrectCode );
+    str = serialProtocolUint64FieldWrite( str, "update",
+                                          snapshot.updateNumber );
+    textFormatString( str, "}" );
+}
+
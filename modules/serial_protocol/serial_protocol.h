@@ -0,0 +1,29 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SERIAL_PROTOCOL_H_
+#define _SERIAL_PROTOCOL_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define SERIAL_PROTOCOL_FRAME_START          '{'
+#define SERIAL_PROTOCOL_FRAME_MAX_LENGTH     256
+#define SERIAL_PROTOCOL_RESPONSE_MAX_LENGTH  256
+
+// For received_us when the arrival time of a request is unknown
+#define SERIAL_PROTOCOL_NO_RECEIVE_TIME      0
+
+//=====[Declaration of public data types]======================================
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void serialProtocolRequestProcess( int sessionId, const char* request,
+                                   uint64_t received_us, char* response );
+void serialProtocolErrorWrite( const char* error, char* response );
+
+//=====[#include guards - end]=================================================
+
+#endif // _SERIAL_PROTOCOL_H_
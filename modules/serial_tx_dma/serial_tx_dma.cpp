@@ -0,0 +1,91 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "serial_tx_dma.h"
+
+#if SERIAL_TX_DMA_ENABLED
+
+//=====[Declaration of private defines]========================================
+
+// USART3_TX is on DMA1 stream 3, channel 4 (RM0090, table 42)
+#define SERIAL_TX_DMA_USART      USART3
+#define SERIAL_TX_DMA_STREAM     DMA1_Stream3
+#define SERIAL_TX_DMA_CHANNEL    DMA_CHANNEL_4
+#define SERIAL_TX_DMA_IRQ        DMA1_Stream3_IRQn
+
+//=====[Declaration of private data types]=====================================
+
+//=====[Declaration and initialization of public global objects]===============
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+//=====[Declaration and initialization of private global variables]============
+
+static DMA_HandleTypeDef serialTxDma;
+static Callback<void()> serialTxDmaDoneCallback;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void serialTxDmaIrqHandler();
+static void serialTxDmaTransferEnd( DMA_HandleTypeDef* dma );
+
+//=====[Implementations of public functions]===================================
+
+// mbed keeps the UART itself: it has configured it and owns its interrupt
+// vector, so only the DMA request is switched on and off here. The end of a
+// transfer is taken from the stream's own interrupt, not from the UART's
+// TC interrupt, which mbed's handler would never clear.
+void serialTxDmaInit( Callback<void()> onDone )
+{
+    serialTxDmaDoneCallback = onDone;
+
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    serialTxDma.Instance = SERIAL_TX_DMA_STREAM;
+    serialTxDma.Init.Channel = SERIAL_TX_DMA_CHANNEL;
+    serialTxDma.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    serialTxDma.Init.PeriphInc = DMA_PINC_DISABLE;
+    serialTxDma.Init.MemInc = DMA_MINC_ENABLE;
+    serialTxDma.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    serialTxDma.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    serialTxDma.Init.Mode = DMA_NORMAL;
+    serialTxDma.Init.Priority = DMA_PRIORITY_LOW;
+    serialTxDma.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    HAL_DMA_Init( &serialTxDma );
+    serialTxDma.XferCpltCallback = &serialTxDmaTransferEnd;
+    serialTxDma.XferErrorCallback = &serialTxDmaTransferEnd;
+
+    NVIC_SetVector( SERIAL_TX_DMA_IRQ, (uint32_t)&serialTxDmaIrqHandler );
+    NVIC_EnableIRQ( SERIAL_TX_DMA_IRQ );
+}
+
+// data must stay in place until the callback, and must not be in the CCM
+// RAM, which the DMA cannot read. The TX interrupt must be off meanwhile.
+void serialTxDmaStart( const char* data, int length )
+{
+    HAL_DMA_Start_IT( &serialTxDma, (uint32_t)data,
+                      (uint32_t)&SERIAL_TX_DMA_USART->DR, length );
+    SET_BIT( SERIAL_TX_DMA_USART->CR3, USART_CR3_DMAT );
+}
+
+//=====[Implementations of private functions]==================================
+
+static void serialTxDmaIrqHandler()
+{
+    HAL_DMA_IRQHandler( &serialTxDma );
+}
+
+// The last byte is in the data register, so the TX interrupt can take over
+// as soon as the callback restarts it. A transfer error ends the transfer
+// all the same, so the output never stalls.
+static void serialTxDmaTransferEnd( DMA_HandleTypeDef* dma )
+{
+    (void)dma;
+    CLEAR_BIT( SERIAL_TX_DMA_USART->CR3, USART_CR3_DMAT );
+    serialTxDmaDoneCallback();
+}
+
+#endif // SERIAL_TX_DMA_ENABLED
@@ -0,0 +1,34 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SERIAL_TX_DMA_H_
+#define _SERIAL_TX_DMA_H_
+
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+
+//=====[Declaration of public defines]=========================================
+
+// DMA transmission on the USB console UART, USART3 on the NUCLEO-F429ZI.
+// Other targets, and the host tests, send everything from the TX interrupt.
+#ifndef SERIAL_TX_DMA_ENABLED
+#if defined(TARGET_NUCLEO_F429ZI)
+#define SERIAL_TX_DMA_ENABLED    1
+#else
+#define SERIAL_TX_DMA_ENABLED    0
+#endif
+#endif
+
+// What one transfer can move
+#define SERIAL_TX_DMA_MAX_LENGTH    65535
+
+//=====[Declaration of public data types]======================================
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void serialTxDmaInit( Callback<void()> onDone );
+void serialTxDmaStart( const char* data, int length );
+
+//=====[#include guards - end]=================================================
+
+#endif // _SERIAL_TX_DMA_H_
@@ -6,6 +6,7 @@
 #include "siren.h"
 
 #include "smart_home_system.h"
+#include "output_manager.h"
 
 //=====[Declaration of private defines]========================================
 
@@ -13,8 +14,6 @@
 
 //=====[Declaration and initialization of public global objects]===============
 
-DigitalOut sirenPin(PE_10);
-
 //=====[Declaration of external public global variables]=======================
 
 //=====[Declaration and initialization of public global variables]=============
@@ -29,7 +28,7 @@ static bool sirenState = OFF;
 
 void sirenInit()
 {
-    sirenPin = ON;
+    outputManagerWrite( OUTPUT_SIREN, ON );
 }
 
 bool sirenStateRead()
@@ -50,10 +49,11 @@ void sirenUpdate( int strobeTime )
     if( sirenState ) {
         if( accumulatedTimeAlarm >= strobeTime ) {
                 accumulatedTimeAlarm = 0;
-                sirenPin= !sirenPin;
+                outputManagerWrite( OUTPUT_SIREN,
+                                    !outputManagerRead( OUTPUT_SIREN ) );
         }
     } else {
-        sirenPin = ON;
+        outputManagerWrite( OUTPUT_SIREN, ON );
     }
 }
 
@@ -9,6 +9,17 @@
 #include "fire_alarm.h"
 #include "pc_serial_com.h"
 #include "event_log.h"
+#include "date_and_time.h"
+#include "telemetry.h"
+#include "modbus_slave.h"
+#include "parameters.h"
+#include "user_codes.h"
+#include "matrix_keypad.h"
+#include "power_manager.h"
+#include "output_manager.h"
+#include "system_watchdog.h"
+#include "trace_buffer.h"
+#include "metrics.h"
 
 //=====[Declaration of private defines]========================================
 
@@ -22,24 +33,157 @@
 
 //=====[Declaration and initialization of private global variables]============
 
+static smartHomeSystemLoopStats_t loopStats = { 0, 0, 0 };
+static int activeHoldTime_ms = SYSTEM_ACTIVE_HOLD_TIME_MS;
+
 //=====[Declarations (prototypes) of private functions]========================
 
+static void smartHomeSystemTaskRun( systemWatchdogTask_t task,
+                                    void (*taskUpdate)() );
+static void smartHomeSystemResetReport();
+static void smartHomeSystemSleep();
+static bool smartHomeSystemStandbyAllowed();
+static int smartHomeSystemStandbyTime();
+
 //=====[Implementations of public functions]===================================
 //Inicializacion de variables de estado, de puertos y comunicacion inicial por serie
 void smartHomeSystemInit()
 {
+    traceBufferInit();
+    dateAndTimeInit();
+    powerManagerInit();
+    outputManagerInit();
     userInterfaceInit();
     fireAlarmInit();
+    userCodesInit(); // before the master code is checked against it
+    parametersInit();
     pcSerialComInit(); //Enviar por puerto serie los comandos de cada tecla.
+    modbusSlaveInit();
+    outputManagerCommit();
+    systemWatchdogInit();
+    smartHomeSystemResetReport();
 }
 //while infinito
 void smartHomeSystemUpdate()
 {
-    userInterfaceUpdate();
-    fireAlarmUpdate();    
-    pcSerialComUpdate();
-    eventLogUpdate();
-    delay(SYSTEM_TIME_INCREMENT_MS); // bloqueo de 10ms que tomamos como valido.
+    uint64_t loopStart_us = dateAndTimeMonotonicRead();
+
+    TRACE_BUFFER_WRITE( TRACE_EVENT_TIME_SYNC, loopStart_us );
+    dateAndTimeUpdate();
+    smartHomeSystemTaskRun( SYSTEM_WATCHDOG_TASK_USER_INTERFACE,
+                            &userInterfaceUpdate );
+    smartHomeSystemTaskRun( SYSTEM_WATCHDOG_TASK_FIRE_ALARM,
+                            &fireAlarmUpdate );
+    smartHomeSystemTaskRun( SYSTEM_WATCHDOG_TASK_PC_SERIAL_COM,
+                            &pcSerialComUpdate );
+    smartHomeSystemTaskRun( SYSTEM_WATCHDOG_TASK_EVENT_LOG,
+                            &eventLogUpdate );
+    smartHomeSystemTaskRun( SYSTEM_WATCHDOG_TASK_USER_CODES,
+                            &userCodesUpdate );
+    telemetryUpdate();
+    modbusSlaveUpdate();
+    outputManagerCommit();
+
+    loopStats.numberOfLoops++;
+    loopStats.lastLoopTime_us =
+        (uint32_t)( dateAndTimeMonotonicRead() - loopStart_us );
+    if ( loopStats.lastLoopTime_us > loopStats.maxLoopTime_us ) {
+        loopStats.maxLoopTime_us = loopStats.lastLoopTime_us;
+    }
+    // An overrun: the work alone took longer than the tick period
+    if ( loopStats.lastLoopTime_us > SYSTEM_TIME_INCREMENT_MS * 1000 ) {
+        metricsCounterIncrement( METRICS_COUNTER_LOOP_OVERRUNS );
+    }
+    metricsHistogramRecord( METRICS_HISTOGRAM_LOOP_TIME_US,
+                            loopStats.lastLoopTime_us );
+    metricsGaugeWrite( METRICS_GAUGE_MAX_LOOP_TIME_US,
+                       loopStats.maxLoopTime_us );
+    smartHomeSystemSleep();
+}
+
+void smartHomeSystemLoopStatsRead( smartHomeSystemLoopStats_t* stats )
+{
+    *stats = loopStats;
 }
 
 //=====[Implementations of private functions]==================================
+
+// The hardware watchdog is only kicked while every supervised task returns
+// within its deadline
+static void smartHomeSystemTaskRun( systemWatchdogTask_t task,
+                                    void (*taskUpdate)() )
+{
+    systemWatchdogTaskBegin( task );
+    TRACE_BUFFER_WRITE( TRACE_EVENT_TASK_BEGIN, task );
+    taskUpdate();
+    TRACE_BUFFER_WRITE( TRACE_EVENT_TASK_END, task );
+    systemWatchdogTaskEnd( task );
+}
+
+static void smartHomeSystemResetReport()
+{
+    char report[SYSTEM_WATCHDOG_REPORT_STR_LENGTH];
+
+    systemWatchdogResetReportRead( report );
+    pcSerialComNotificationWrite( report );
+}
+
+// Ticks every SYSTEM_TIME_INCREMENT_MS while anything counts time in ticks
+// (siren and strobe, keypad scan and debounce, serial output, telemetry, a
+// Modbus frame), and otherwise stands by until the next deadline or an
+// interrupt. The UARTs hand their wake-up to their RX pins meanwhile.
+static void smartHomeSystemSleep()
+{
+    int standbyTime_ms = 0;
+
+    if ( SYSTEM_STANDBY_ENABLED && smartHomeSystemStandbyAllowed() ) {
+        standbyTime_ms = smartHomeSystemStandbyTime();
+    }
+    if ( standbyTime_ms <= SYSTEM_TIME_INCREMENT_MS ) {
+        powerManagerTickSleep( SYSTEM_TIME_INCREMENT_MS );
+        return;
+    }
+    pcSerialComStandbyEnter();
+    modbusSlaveStandbyEnter();
+    if ( powerManagerStandby( standbyTime_ms ) ) {
+        activeHoldTime_ms = SYSTEM_ACTIVE_HOLD_TIME_MS;
+    }
+    modbusSlaveStandbyExit();
+    pcSerialComStandbyExit();
+}
+
+static bool smartHomeSystemStandbyAllowed()
+{
+    if ( sirenStateRead() || !matrixKeypadIdleRead() ||
+         !pcSerialComIdleRead() || !modbusSlaveIdleRead() ||
+         telemetrySubscribedRead() ) {
+        activeHoldTime_ms = SYSTEM_ACTIVE_HOLD_TIME_MS;
+        return false;
+    }
+    if ( activeHoldTime_ms > 0 ) {
+        activeHoldTime_ms -= SYSTEM_TIME_INCREMENT_MS;
+        return false;
+    }
+    return true;
+}
+
+// Up to the earliest deadline counted on the monotonic clock: the next
+// temperature sample, a pending save of the user codes and the superloop's
+// own watchdog deadline. Rounded up, so that the deadline has passed on
+// waking.
+static int smartHomeSystemStandbyTime()
+{
+    uint64_t now_us = dateAndTimeMonotonicRead();
+    uint64_t deadline_us = fireAlarmDeadlineRead();
+
+    if ( userCodesDeadlineRead() < deadline_us ) {
+        deadline_us = userCodesDeadlineRead();
+    }
+    if ( systemWatchdogDeadlineRead() < deadline_us ) {
+        deadline_us = systemWatchdogDeadlineRead();
+    }
+    if ( deadline_us <= now_us ) {
+        return 0;
+    }
+    return (int)( ( deadline_us - now_us + 999 ) / 1000 );
+}
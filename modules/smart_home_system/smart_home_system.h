@@ -3,16 +3,38 @@
 #ifndef _SMART_HOME_SYSTEM_H_
 #define _SMART_HOME_SYSTEM_H_
 
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
 //=====[Declaration of public defines]=========================================
 
 #define SYSTEM_TIME_INCREMENT_MS   10
 
+// With nothing time-driven going on, the superloop stands by until the
+// earliest deadline of the modules, a second away at most, and any wake-up
+// interrupt ends the standby early. After activity it keeps ticking for
+// SYSTEM_ACTIVE_HOLD_TIME_MS before standing by again. A standby is a deep
+// sleep: the clocks stop but for the low power ticker, and the keypad, the
+// gas sensor, the alarm test button and the RX pins wake the core.
+#ifndef SYSTEM_STANDBY_ENABLED
+#define SYSTEM_STANDBY_ENABLED        1
+#endif
+#define SYSTEM_ACTIVE_HOLD_TIME_MS   2000
+
 //=====[Declaration of public data types]======================================
 
+typedef struct smartHomeSystemLoopStats {
+    uint32_t numberOfLoops;
+    uint32_t lastLoopTime_us;
+    uint32_t maxLoopTime_us;
+} smartHomeSystemLoopStats_t;
+
 //=====[Declarations (prototypes) of public functions]=========================
 
 void smartHomeSystemInit();
 void smartHomeSystemUpdate();
+void smartHomeSystemLoopStatsRead( smartHomeSystemLoopStats_t* stats );
 
 //=====[#include guards - end]=================================================
 
@@ -0,0 +1,114 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SPSC_QUEUE_H_
+#define _SPSC_QUEUE_H_
+
+//=====[Libraries]=============================================================
+
+#include <atomic>
+
+//=====[Declaration of public defines]=========================================
+
+//=====[Declaration of public data types]======================================
+
+// Fixed-size FIFO for handing data from one producer to one consumer, for
+// instance from an interrupt to the superloop. Neither side ever blocks or
+// masks interrupts: each index has a single writer, and an item is
+// published by the release store of head only once it has been written.
+//
+// head and tail run freely and are reduced modulo Capacity on access, so
+// every slot can be used and writeCount()/readCount() tell how many items
+// have gone through. Capacity must be a power of two.
+//
+// push() and writeCount() belong to the producer, pop(), peek() and
+// readCount() to the consumer. size(), space() and empty() can be called
+// from either side; they are exact for the caller's own side and a
+// snapshot of the other's.
+template <typename T, unsigned int Capacity>
+class SpscQueue {
+    static_assert( Capacity >= 2 && ( Capacity & ( Capacity - 1 ) ) == 0,
+                   "SpscQueue capacity must be a power of two" );
+
+public:
+    SpscQueue() : head( 0 ), tail( 0 ) {}
+
+    SpscQueue( const SpscQueue& ) = delete;
+    SpscQueue& operator=( const SpscQueue& ) = delete;
+
+    // False, leaving the queue unchanged, when it is full
+    bool push( const T& item )
+    {
+        unsigned int currentHead = head.load( std::memory_order_relaxed );
+        if ( currentHead - tail.load( std::memory_order_acquire ) >= Capacity ) {
+            return false;
+        }
+        items[currentHead & ( Capacity - 1 )] = item;
+        head.store( currentHead + 1, std::memory_order_release );
+        return true;
+    }
+
+    // False when it is empty
+    bool pop( T* item )
+    {
+        unsigned int currentTail = tail.load( std::memory_order_relaxed );
+        if ( head.load( std::memory_order_acquire ) == currentTail ) {
+            return false;
+        }
+        *item = items[currentTail & ( Capacity - 1 )];
+        tail.store( currentTail + 1, std::memory_order_release );
+        return true;
+    }
+
+    // The oldest item, left in the queue
+    bool peek( T* item ) const
+    {
+        unsigned int currentTail = tail.load( std::memory_order_relaxed );
+        if ( head.load( std::memory_order_acquire ) == currentTail ) {
+            return false;
+        }
+        *item = items[currentTail & ( Capacity - 1 )];
+        return true;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    // tail is loaded first: head never falls behind an older tail
+    unsigned int size() const
+    {
+        unsigned int currentTail = tail.load( std::memory_order_acquire );
+        return head.load( std::memory_order_acquire ) - currentTail;
+    }
+
+    unsigned int space() const
+    {
+        return Capacity - size();
+    }
+
+    // Items pushed and popped since the start, modulo 2^32
+    unsigned int writeCount() const
+    {
+        return head.load( std::memory_order_acquire );
+    }
+
+    unsigned int readCount() const
+    {
+        return tail.load( std::memory_order_acquire );
+    }
+
+    static constexpr unsigned int capacity()
+    {
+        return Capacity;
+    }
+
+private:
+    T items[Capacity];
+    std::atomic<unsigned int> head;
+    std::atomic<unsigned int> tail;
+};
+
+//=====[#include guards - end]=================================================
+
+#endif // _SPSC_QUEUE_H_
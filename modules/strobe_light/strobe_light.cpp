@@ -5,6 +5,7 @@
 
 #include "strobe_light.h"
 #include "smart_home_system.h"
+#include "output_manager.h"
 
 //=====[Declaration of private defines]========================================
 
@@ -12,8 +13,6 @@
 
 //=====[Declaration and initialization of public global objects]===============
 
-DigitalOut strobeLight(LED1);
-
 //=====[Declaration of external public global variables]=======================
 
 //=====[Declaration and initialization of public global variables]=============
@@ -28,7 +27,7 @@ static bool strobeLightState = OFF;
 
 void strobeLightInit()
 {
-    strobeLight = OFF;
+    outputManagerWrite( OUTPUT_STROBE_LIGHT, OFF );
 }
 
 bool strobeLightStateRead()
@@ -49,10 +48,11 @@ void strobeLightUpdate( int strobeTime )
     if( strobeLightState ) {
         if( accumulatedTimeAlarm >= strobeTime ) {
             accumulatedTimeAlarm = 0;
-            strobeLight= !strobeLight;
+            outputManagerWrite( OUTPUT_STROBE_LIGHT,
+                                !outputManagerRead( OUTPUT_STROBE_LIGHT ) );
         }
     } else {
-        strobeLight = OFF;
+        outputManagerWrite( OUTPUT_STROBE_LIGHT, OFF );
     }
 }
 
@@ -0,0 +1,236 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "system_watchdog.h"
+
+#include "date_and_time.h"
+#include "text_format.h"
+
+//=====[Declaration of private defines]========================================
+
+#define SYSTEM_WATCHDOG_TIMEOUT_MS           1000
+#define SYSTEM_WATCHDOG_SUPERVISION_US     250000
+
+// Longest the superloop may spend outside the registered tasks: a standby
+// plus the modules that are not supervised
+#define SYSTEM_WATCHDOG_LOOP_DEADLINE_MS     3000
+
+#define SYSTEM_WATCHDOG_RETAINED_MAGIC       0x57444F47
+#define SYSTEM_WATCHDOG_NO_TASK              -1
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct systemWatchdogTaskInfo {
+    const char* name;
+    uint32_t deadline_ms;
+} systemWatchdogTaskInfo_t;
+
+// Lives in the backup SRAM, which a reset does not clear. check guards
+// against the random content found there after a power loss.
+typedef struct systemWatchdogRetained {
+    uint32_t magic;
+    uint32_t watchdogResets;
+    uint32_t overrunRecorded;
+    int32_t overrunTask;
+    uint32_t overrunDuration_ms;
+    uint32_t overrunTime;
+    uint32_t check;
+} systemWatchdogRetained_t;
+
+//=====[Declaration and initialization of public global objects]===============
+
+// Wakes the core out of a deep sleep to kick the watchdog, which keeps
+// counting in stop mode; a Ticker would hold the deep sleep lock for good
+LowPowerTicker systemWatchdogTicker;
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+//=====[Declaration and initialization of private global variables]============
+
+static const systemWatchdogTaskInfo_t
+    systemWatchdogTasks[SYSTEM_WATCHDOG_NUMBER_OF_TASKS] = {
+    { "userInterface", 2000 },
+    { "fireAlarm",     2000 },
+    // May store parameters, and a flash erase takes seconds
+    { "pcSerialCom",   6000 },
+    { "eventLog",      2000 },
+    // Stores the user code table
+    { "userCodes",     6000 },
+};
+
+static systemWatchdogRetained_t* const retained =
+    (systemWatchdogRetained_t*)BKPSRAM_BASE;
+
+static volatile int runningTask = SYSTEM_WATCHDOG_NO_TASK;
+static volatile uint64_t runningTaskBegin_us = 0;
+static volatile uint64_t lastCheckIn_us = 0;
+
+// What the current boot found, for the report
+static reset_reason_t resetReason = RESET_REASON_UNKNOWN;
+static systemWatchdogRetained_t resetRecord;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void systemWatchdogRetainedInit();
+static uint32_t systemWatchdogRetainedCheck( const systemWatchdogRetained_t* record );
+static void systemWatchdogSupervise();
+static void systemWatchdogOverrunRecord( int task, uint64_t duration_us,
+                                         uint64_t now_us );
+static const char* systemWatchdogResetReasonName( reset_reason_t reason );
+
+//=====[Implementations of public functions]===================================
+
+// Call last in the initialisation, so that slow start-up work (reading the
+// KVStore) does not count against any deadline
+void systemWatchdogInit()
+{
+    resetReason = ResetReason::get();
+    systemWatchdogRetainedInit();
+
+    resetRecord = *retained;
+    if ( resetReason == RESET_REASON_WATCHDOG ) {
+        retained->watchdogResets++;
+        resetRecord.watchdogResets = retained->watchdogResets;
+    } else {
+        resetRecord.overrunRecorded = false;
+    }
+    retained->overrunRecorded = false;
+    retained->check = systemWatchdogRetainedCheck( retained );
+
+    lastCheckIn_us = dateAndTimeMonotonicRead();
+    Watchdog::get_instance().start( SYSTEM_WATCHDOG_TIMEOUT_MS );
+    systemWatchdogTicker.attach( &systemWatchdogSupervise,
+        std::chrono::microseconds( SYSTEM_WATCHDOG_SUPERVISION_US ) );
+}
+
+void systemWatchdogTaskBegin( systemWatchdogTask_t task )
+{
+    core_util_critical_section_enter();
+    runningTaskBegin_us = dateAndTimeMonotonicRead();
+    runningTask = task;
+    core_util_critical_section_exit();
+}
+
+void systemWatchdogTaskEnd( systemWatchdogTask_t task )
+{
+    core_util_critical_section_enter();
+    lastCheckIn_us = dateAndTimeMonotonicRead();
+    runningTask = SYSTEM_WATCHDOG_NO_TASK;
+    core_util_critical_section_exit();
+}
+
+// When a standby must end at the latest for the superloop to check in
+// again before its deadline, with a supervision period to spare
+uint64_t systemWatchdogDeadlineRead()
+{
+    uint64_t checkIn_us;
+
+    core_util_critical_section_enter();
+    checkIn_us = lastCheckIn_us;
+    core_util_critical_section_exit();
+    return checkIn_us + (uint64_t)SYSTEM_WATCHDOG_LOOP_DEADLINE_MS * 1000 -
+           SYSTEM_WATCHDOG_SUPERVISION_US;
+}
+
+// Why the panel last reset and, after a watchdog reset, which task overran
+void systemWatchdogResetReportRead( char* str )
+{
+    char* end = textFormatString( str, "Reset reason: " );
+    end = textFormatString( end, systemWatchdogResetReasonName( resetReason ) );
+    end = textFormatString( end, ", watchdog resets: " );
+    end = textFormatUnsigned( end, resetRecord.watchdogResets );
+    end = textFormatString( end, "\r\n" );
+    if ( !resetRecord.overrunRecorded ) {
+        return;
+    }
+    if ( resetRecord.overrunTask == SYSTEM_WATCHDOG_NO_TASK ) {
+        end = textFormatString( end, "superloop" );
+    } else {
+        end = textFormatString( end,
+                  systemWatchdogTasks[resetRecord.overrunTask].name );
+    }
+    end = textFormatString( end, " overran its deadline after " );
+    end = textFormatUnsigned( end, resetRecord.overrunDuration_ms );
+    end = textFormatString( end, " ms at " );
+    dateAndTimeFormat( end, (time_t)resetRecord.overrunTime );
+}
+
+//=====[Implementations of private functions]==================================
+
+static void systemWatchdogRetainedInit()
+{
+    __HAL_RCC_PWR_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+    __HAL_RCC_BKPSRAM_CLK_ENABLE();
+
+    if ( retained->magic != SYSTEM_WATCHDOG_RETAINED_MAGIC ||
+         retained->check != systemWatchdogRetainedCheck( retained ) ) {
+        memset( retained, 0, sizeof( *retained ) );
+        retained->magic = SYSTEM_WATCHDOG_RETAINED_MAGIC;
+        retained->overrunTask = SYSTEM_WATCHDOG_NO_TASK;
+        retained->check = systemWatchdogRetainedCheck( retained );
+    }
+}
+
+static uint32_t systemWatchdogRetainedCheck( const systemWatchdogRetained_t* record )
+{
+    return ~( record->magic ^ record->watchdogResets ^ record->overrunRecorded ^
+              (uint32_t)record->overrunTask ^ record->overrunDuration_ms ^
+              record->overrunTime );
+}
+
+// Runs from the ticker, so it keeps going when the superloop hangs. A task
+// is only judged while it runs: the others are waiting for it. Once an
+// overrun is recorded the watchdog is no longer kicked and resets the MCU.
+static void systemWatchdogSupervise()
+{
+    uint64_t now_us = dateAndTimeMonotonicRead();
+    int task = runningTask;
+
+    if ( retained->overrunRecorded ) {
+        return;
+    }
+    if ( task != SYSTEM_WATCHDOG_NO_TASK ) {
+        if ( now_us - runningTaskBegin_us >
+             (uint64_t)systemWatchdogTasks[task].deadline_ms * 1000 ) {
+            systemWatchdogOverrunRecord( task, now_us - runningTaskBegin_us,
+                                         now_us );
+            return;
+        }
+    } else if ( now_us - lastCheckIn_us >
+                (uint64_t)SYSTEM_WATCHDOG_LOOP_DEADLINE_MS * 1000 ) {
+        systemWatchdogOverrunRecord( SYSTEM_WATCHDOG_NO_TASK,
+                                     now_us - lastCheckIn_us, now_us );
+        return;
+    }
+    Watchdog::get_instance().kick();
+}
+
+static void systemWatchdogOverrunRecord( int task, uint64_t duration_us,
+                                         uint64_t now_us )
+{
+    retained->overrunTask = task;
+    retained->overrunDuration_ms = (uint32_t)( duration_us / 1000 );
+    retained->overrunTime = (uint32_t)dateAndTimeMonotonicToEpoch( now_us );
+    retained->overrunRecorded = true;
+    retained->check = systemWatchdogRetainedCheck( retained );
+}
+
+static const char* systemWatchdogResetReasonName( reset_reason_t reason )
+{
+    switch ( reason ) {
+        case RESET_REASON_POWER_ON:       return "power on";
+        case RESET_REASON_PIN_RESET:      return "reset pin";
+        case RESET_REASON_BROWN_OUT:      return "brown-out";
+        case RESET_REASON_SOFTWARE:       return "software";
+        case RESET_REASON_WATCHDOG:       return "watchdog";
+        case RESET_REASON_LOCKUP:         return "lockup";
+        case RESET_REASON_WAKE_LOW_POWER: return "low power wake-up";
+        case RESET_REASON_MULTIPLE:       return "multiple";
+        default:                          return "unknown";
+    }
+}
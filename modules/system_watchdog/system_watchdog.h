@@ -0,0 +1,35 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SYSTEM_WATCHDOG_H_
+#define _SYSTEM_WATCHDOG_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define SYSTEM_WATCHDOG_REPORT_STR_LENGTH    160
+
+//=====[Declaration of public data types]======================================
+
+typedef enum {
+    SYSTEM_WATCHDOG_TASK_USER_INTERFACE,
+    SYSTEM_WATCHDOG_TASK_FIRE_ALARM,
+    SYSTEM_WATCHDOG_TASK_PC_SERIAL_COM,
+    SYSTEM_WATCHDOG_TASK_EVENT_LOG,
+    SYSTEM_WATCHDOG_TASK_USER_CODES,
+    SYSTEM_WATCHDOG_NUMBER_OF_TASKS,
+} systemWatchdogTask_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void systemWatchdogInit();
+void systemWatchdogTaskBegin( systemWatchdogTask_t task );
+void systemWatchdogTaskEnd( systemWatchdogTask_t task );
+uint64_t systemWatchdogDeadlineRead();
+void systemWatchdogResetReportRead( char* str );
+
+//=====[#include guards - end]=================================================
+
+#endif // _SYSTEM_WATCHDOG_H_
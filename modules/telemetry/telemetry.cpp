@@ -0,0 +1,181 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "telemetry.h"
+
+#include "fire_alarm.h"
+#include "pc_serial_com.h"
+#include "date_and_time.h"
+#include "smart_home_system.h"
+#include "text_format.h"
+#include "metrics.h"
+
+//=====[Declaration of private defines]========================================
+
+#define TELEMETRY_MIN_PERIOD_MS       SYSTEM_TIME_INCREMENT_MS
+#define TELEMETRY_MAX_PERIOD_MS       3600000
+#define TELEMETRY_SAMPLE_STR_LENGTH   24
+#define TELEMETRY_HEADER_STR_LENGTH   160
+#define TELEMETRY_FRAME_STR_LENGTH    (TELEMETRY_HEADER_STR_LENGTH + \
+                                       TELEMETRY_MAX_BATCH_SIZE * \
+                                       TELEMETRY_SAMPLE_STR_LENGTH)
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct telemetrySample {
+    int temperatureC_x100;
+    bool gasDetector;
+    int alarmCause;
+} telemetrySample_t;
+
+//=====[Declaration and initialization of public global objects]===============
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+//=====[Declaration and initialization of private global variables]============
+
+static bool telemetryEnabled = false;
+static int telemetrySessionId = 0;
+static int telemetryPeriod_ms = 0;
+static int telemetryBatchSize = 0;
+static int accumulatedTelemetryTime_ms = 0;
+static uint32_t telemetrySequence = 0;
+
+static telemetrySample_t telemetrySamples[TELEMETRY_MAX_BATCH_SIZE];
+static int numberOfTelemetrySamples = 0;
+static uint64_t firstSampleTime_us = 0;
+static uint32_t batchMaxLoopTime_us = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void telemetryLoopTimeTrack();
+static void telemetrySampleTake();
+static void telemetryBatchSend();
+
+//=====[Implementations of public functions]===================================
+
+// Samples are taken on the system tick and sent as one line per batch:
+// {"tlm":{"seq":3,"t0_us":..,"period_ms":100,"loops":..,"loopMax_us":..,
+//  "s":[[tempC_x100,gas,cause],...]}}
+void telemetryUpdate()
+{
+    if ( !telemetryEnabled ) {
+        return;
+    }
+    telemetryLoopTimeTrack();
+    accumulatedTelemetryTime_ms = accumulatedTelemetryTime_ms +
+                                  SYSTEM_TIME_INCREMENT_MS;
+    if ( accumulatedTelemetryTime_ms >= telemetryPeriod_ms ) {
+        accumulatedTelemetryTime_ms = 0;
+        telemetrySampleTake();
+        if ( numberOfTelemetrySamples >= telemetryBatchSize ) {
+            telemetryBatchSend();
+        }
+    }
+}
+
+// A new subscription replaces the previous one, from any session
+bool telemetrySubscribe( int sessionId, int period_ms, int batchSize )
+{
+    if ( period_ms < TELEMETRY_MIN_PERIOD_MS ||
+         period_ms > TELEMETRY_MAX_PERIOD_MS ||
+         batchSize < 1 || batchSize > TELEMETRY_MAX_BATCH_SIZE ) {
+        return false;
+    }
+    telemetrySessionId = sessionId;
+    telemetryPeriod_ms = period_ms;
+    telemetryBatchSize = batchSize;
+    accumulatedTelemetryTime_ms = 0;
+    numberOfTelemetrySamples = 0;
+    batchMaxLoopTime_us = 0;
+    telemetryEnabled = true;
+    return true;
+}
+
+void telemetryUnsubscribe()
+{
+    telemetryEnabled = false;
+    numberOfTelemetrySamples = 0;
+}
+
+bool telemetrySubscribedRead()
+{
+    return telemetryEnabled;
+}
+
+//=====[Implementations of private functions]==================================
+
+// loopMax_us is the longest loop since the previous batch. It is kept here,
+// so the system-wide maximum and its gauge are never reset by telemetry.
+// Called before the loop time of the current pass is known, so it sees the
+// previous pass.
+static void telemetryLoopTimeTrack()
+{
+    smartHomeSystemLoopStats_t loopStats;
+
+    smartHomeSystemLoopStatsRead( &loopStats );
+    if ( loopStats.lastLoopTime_us > batchMaxLoopTime_us ) {
+        batchMaxLoopTime_us = loopStats.lastLoopTime_us;
+    }
+}
+
+static void telemetrySampleTake()
+{
+    telemetrySample_t* sample = &telemetrySamples[numberOfTelemetrySamples];
+    fireAlarmSnapshot_t snapshot;
+
+    fireAlarmSnapshotRead( &snapshot );
+    if ( numberOfTelemetrySamples == 0 ) {
+        firstSampleTime_us = snapshot.monotonic_us;
+    }
+    sample->temperatureC_x100 = (int)( snapshot.temperatureC * 100 );
+    sample->gasDetector = snapshot.gasDetector;
+    sample->alarmCause = snapshot.cause;
+    numberOfTelemetrySamples++;
+}
+
+// The batch is dropped whole if the TX ring cannot take it, so the stream
+// never delays the alarm loop
+static void telemetryBatchSend()
+{
+    static char frame[TELEMETRY_FRAME_STR_LENGTH];
+    smartHomeSystemLoopStats_t loopStats;
+    char* str;
+    int i;
+
+    smartHomeSystemLoopStatsRead( &loopStats );
+
+    str = textFormatString( frame, "{\"tlm\":{\"seq\":" );
+    str = textFormatUnsigned( str, telemetrySequence );
+    str = textFormatString( str, ",\"t0_us\":" );
+    str = textFormatUint64( str, firstSampleTime_us );
+    str = textFormatString( str, ",\"period_ms\":" );
+    str = textFormatInt( str, telemetryPeriod_ms );
+    str = textFormatString( str, ",\"loops\":" );
+    str = textFormatUnsigned( str, loopStats.numberOfLoops );
+    str = textFormatString( str, ",\"loopMax_us\":" );
+    str = textFormatUnsigned( str, batchMaxLoopTime_us );
+    str = textFormatString( str, ",\"s\":[" );
+    for ( i = 0; i < numberOfTelemetrySamples; i++ ) {
+        str = textFormatString( str, ( i == 0 ) ? "[" : ",[" );
+        str = textFormatInt( str, telemetrySamples[i].temperatureC_x100 );
+        str = textFormatString( str, "," );
+        str = textFormatInt( str, telemetrySamples[i].gasDetector );
+        str = textFormatString( str, "," );
+        str = textFormatInt( str, telemetrySamples[i].alarmCause );
+        str = textFormatString( str, "]" );
+    }
+    textFormatString( str, "]}}\r\n" );
+
+    if ( !pcSerialComSessionFrameWrite(
+              (pcSerialComSessionId_t)telemetrySessionId, frame ) ) {
+        metricsCounterIncrement( METRICS_COUNTER_TELEMETRY_DROPPED_BATCHES );
+    }
+    telemetrySequence++;
+    numberOfTelemetrySamples = 0;
+    batchMaxLoopTime_us = 0;
+}
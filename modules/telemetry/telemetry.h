@@ -0,0 +1,21 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+//=====[Declaration of public defines]=========================================
+
+#define TELEMETRY_MAX_BATCH_SIZE    16
+
+//=====[Declaration of public data types]======================================
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void telemetryUpdate();
+bool telemetrySubscribe( int sessionId, int period_ms, int batchSize );
+void telemetryUnsubscribe();
+bool telemetrySubscribedRead();
+
+//=====[#include guards - end]=================================================
+
+#endif // _TELEMETRY_H_
@@ -5,10 +5,10 @@
 #include "temperature_sensor.h"
 
 #include "smart_home_system.h"
+#include "date_and_time.h"
 
 //=====[Declaration of private defines]========================================
 
-#define LM35_NUMBER_OF_AVG_SAMPLES    10
 
 //=====[Declaration of private data types]=====================================
 
@@ -23,7 +23,11 @@ AnalogIn lm35(A1);
 //=====[Declaration and initialization of private global variables]============
 
 float lm35TemperatureC = 0.0;
-float lm35ReadingsArray[LM35_NUMBER_OF_AVG_SAMPLES];
+float lm35ReadingsArray[LM35_NUMBER_OF_AVG_SAMPLES_MAX];
+
+static uint64_t lm35ReadingTimes_us[LM35_NUMBER_OF_AVG_SAMPLES_MAX];
+static int lm35NumberOfReadings = 0;
+static int lm35NumberOfAvgSamples = LM35_NUMBER_OF_AVG_SAMPLES;
 
 //=====[Declarations (prototypes) of private functions]========================
 
@@ -35,31 +39,47 @@ void temperatureSensorInit()
 {
     int i;
     
-    for( i=0; i<LM35_NUMBER_OF_AVG_SAMPLES ; i++ ) {
+    for( i=0; i<LM35_NUMBER_OF_AVG_SAMPLES_MAX ; i++ ) {
         lm35ReadingsArray[i] = 0;
     }
 }
 
+// The average covers a fixed time, the lm35NumberOfAvgSamples ticks it
+// spans while the superloop ticks. In standby the samples are a second
+// apart, so fewer of them, down to the newest alone, are averaged rather
+// than stretching the window over tens of seconds.
 void temperatureSensorUpdate()
 {
     static int lm35SampleIndex = 0;
+    uint64_t now_us = dateAndTimeMonotonicRead();
+    uint64_t window_us =
+        (uint64_t)lm35NumberOfAvgSamples * SYSTEM_TIME_INCREMENT_MS * 1000;
     float lm35ReadingsSum = 0.0;
     float lm35ReadingsAverage = 0.0;
-
+    int numberOfSamples = 0;
+    int index = 0;
     int i = 0;
 
     lm35ReadingsArray[lm35SampleIndex] = lm35.read();
-       lm35SampleIndex++;
-    if ( lm35SampleIndex >= LM35_NUMBER_OF_AVG_SAMPLES) {
-        lm35SampleIndex = 0;
+    lm35ReadingTimes_us[lm35SampleIndex] = now_us;
+    lm35SampleIndex = ( lm35SampleIndex + 1 ) % LM35_NUMBER_OF_AVG_SAMPLES_MAX;
+    if ( lm35NumberOfReadings < LM35_NUMBER_OF_AVG_SAMPLES_MAX ) {
+        lm35NumberOfReadings++;
     }
-    
-   lm35ReadingsSum = 0.0;
-    for (i = 0; i < LM35_NUMBER_OF_AVG_SAMPLES; i++) {
-        lm35ReadingsSum = lm35ReadingsSum + lm35ReadingsArray[i];
+
+    // From the newest back; the reading just taken always counts
+    for ( i = 0; i < lm35NumberOfAvgSamples && i < lm35NumberOfReadings; i++ ) {
+        index = ( lm35SampleIndex + LM35_NUMBER_OF_AVG_SAMPLES_MAX - 1 - i ) %
+                LM35_NUMBER_OF_AVG_SAMPLES_MAX;
+        if ( i > 0 && now_us - lm35ReadingTimes_us[index] >= window_us ) {
+            break;
+        }
+        lm35ReadingsSum = lm35ReadingsSum + lm35ReadingsArray[index];
+        numberOfSamples++;
     }
-    lm35ReadingsAverage = lm35ReadingsSum / LM35_NUMBER_OF_AVG_SAMPLES;
-       lm35TemperatureC = analogReadingScaledWithTheLM35Formula ( lm35ReadingsAverage );    
+
+    lm35ReadingsAverage = lm35ReadingsSum / numberOfSamples;
+    lm35TemperatureC = analogReadingScaledWithTheLM35Formula( lm35ReadingsAverage );
 }
 
 
@@ -78,6 +98,16 @@ float celsiusToFahrenheit( float tempInCelsiusDegrees )
     return ( tempInCelsiusDegrees * 9.0 / 5.0 + 32.0 );
 }
 
+bool temperatureSensorAverageSamplesWrite( int numberOfSamples )
+{
+    if ( numberOfSamples < 1 ||
+         numberOfSamples > LM35_NUMBER_OF_AVG_SAMPLES_MAX ) {
+        return false;
+    }
+    lm35NumberOfAvgSamples = numberOfSamples;
+    return true;
+}
+
 //=====[Implementations of private functions]==================================
 
 static float analogReadingScaledWithTheLM35Formula( float analogReading )
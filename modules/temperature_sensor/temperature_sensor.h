@@ -5,6 +5,9 @@
 
 //=====[Declaration of public defines]=========================================
 
+#define LM35_NUMBER_OF_AVG_SAMPLES        10
+#define LM35_NUMBER_OF_AVG_SAMPLES_MAX    50
+
 //=====[Declaration of public data types]======================================
 
 //=====[Declarations (prototypes) of public functions]=========================
@@ -14,6 +17,7 @@ void temperatureSensorUpdate();
 float temperatureSensorReadCelsius();
 float temperatureSensorReadFahrenheit();
 float celsiusToFahrenheit( float tempInCelsiusDegrees );
+bool temperatureSensorAverageSamplesWrite( int numberOfSamples );
 
 //=====[#include guards - end]=================================================
 
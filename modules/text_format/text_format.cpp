@@ -0,0 +1,142 @@
+//=====[Libraries]=============================================================
+
+#include "text_format.h"
+
+//=====[Declaration of private defines]========================================
+
+#define TEXT_FORMAT_MAX_DIGITS    20
+
+//=====[Declaration of private data types]=====================================
+
+//=====[Declaration and initialization of public global objects]===============
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+//=====[Declaration and initialization of private global variables]============
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static long textFormatPowerOfTen( int exponent );
+
+//=====[Implementations of public functions]===================================
+
+char* textFormatString( char* str, const char* text )
+{
+    while ( *text != '\0' ) {
+        *str = *text;
+        str++;
+        text++;
+    }
+    *str = '\0';
+    return str;
+}
+
+char* textFormatInt( char* str, long value )
+{
+    if ( value < 0 ) {
+        *str = '-';
+        str++;
+        return textFormatUnsigned( str, 0UL - (unsigned long)value );
+    }
+    return textFormatUnsigned( str, (unsigned long)value );
+}
+
+char* textFormatUnsigned( char* str, unsigned long value )
+{
+    return textFormatZeroPadded( str, value, 1 );
+}
+
+// 64 bit division is a library call on Cortex-M, so values that fit in 32
+// bits take the short path
+char* textFormatUint64( char* str, uint64_t value )
+{
+    char digits[TEXT_FORMAT_MAX_DIGITS];
+    int numberOfDigits = 0;
+
+    if ( value <= 0xFFFFFFFFUL ) {
+        return textFormatUnsigned( str, (unsigned long)value );
+    }
+    while ( value > 0 ) {
+        digits[numberOfDigits] = '0' + (char)( value % 10 );
+        value = value / 10;
+        numberOfDigits++;
+    }
+    while ( numberOfDigits > 0 ) {
+        numberOfDigits--;
+        *str = digits[numberOfDigits];
+        str++;
+    }
+    *str = '\0';
+    return str;
+}
+
+// Digits are produced backwards into a scratch array, then copied with
+// leading zeros up to width
+char* textFormatZeroPadded( char* str, unsigned long value, int width )
+{
+    char digits[TEXT_FORMAT_MAX_DIGITS];
+    int numberOfDigits = 0;
+
+    do {
+        digits[numberOfDigits] = '0' + (char)( value % 10 );
+        value = value / 10;
+        numberOfDigits++;
+    } while ( value > 0 );
+
+    while ( width > numberOfDigits ) {
+        *str = '0';
+        str++;
+        width--;
+    }
+    while ( numberOfDigits > 0 ) {
+        numberOfDigits--;
+        *str = digits[numberOfDigits];
+        str++;
+    }
+    *str = '\0';
+    return str;
+}
+
+// value holds the number scaled by 10^decimals: (2350, 2) gives "23.50"
+char* textFormatFixedPoint( char* str, long value, int decimals )
+{
+    unsigned long magnitude;
+    long scale = textFormatPowerOfTen( decimals );
+
+    if ( value < 0 ) {
+        *str = '-';
+        str++;
+        magnitude = 0UL - (unsigned long)value;
+    } else {
+        magnitude = (unsigned long)value;
+    }
+    str = textFormatUnsigned( str, magnitude / scale );
+    if ( decimals > 0 ) {
+        *str = '.';
+        str++;
+        str = textFormatZeroPadded( str, magnitude % scale, decimals );
+    }
+    return str;
+}
+
+// Rounds to the nearest fixed-point value; no floating point printf needed
+char* textFormatFloat( char* str, float value, int decimals )
+{
+    float scaled = value * textFormatPowerOfTen( decimals );
+    long rounded = (long)( scaled < 0 ? scaled - 0.5f : scaled + 0.5f );
+    return textFormatFixedPoint( str, rounded, decimals );
+}
+
+//=====[Implementations of private functions]==================================
+
+static long textFormatPowerOfTen( int exponent )
+{
+    long power = 1;
+    while ( exponent > 0 ) {
+        power = power * 10;
+        exponent--;
+    }
+    return power;
+}
@@ -0,0 +1,29 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _TEXT_FORMAT_H_
+#define _TEXT_FORMAT_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+//=====[Declaration of public data types]======================================
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Every function writes at str, terminates the text and returns a pointer
+// to the terminator, so that calls can be chained to build a line
+
+char* textFormatString( char* str, const char* text );
+char* textFormatInt( char* str, long value );
+char* textFormatUnsigned( char* str, unsigned long value );
+char* textFormatUint64( char* str, uint64_t value );
+char* textFormatZeroPadded( char* str, unsigned long value, int width );
+char* textFormatFixedPoint( char* str, long value, int decimals );
+char* textFormatFloat( char* str, float value, int decimals );
+
+//=====[#include guards - end]=================================================
+
+#endif // _TEXT_FORMAT_H_
@@ -0,0 +1,148 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "time_sync.h"
+
+#include "date_and_time.h"
+#include "pc_serial_com.h"
+
+//=====[Declaration of private defines]========================================
+
+// Samples whose round trip is this much over the best recent one are
+// queued somewhere and would bias the offset
+#define TIME_SYNC_DELAY_MARGIN_US      2000
+
+// The drift estimate needs samples far enough apart to see the drift
+#define TIME_SYNC_MIN_INTERVAL_US   1000000
+
+//=====[Declaration of private data types]=====================================
+
+// What a session's last exchange still needs: t4 comes with the next request
+typedef struct timeSyncExchange {
+    bool pending;
+    int64_t t1_us;
+    int64_t t2_us;
+    int64_t t3_us;
+} timeSyncExchange_t;
+
+//=====[Declaration and initialization of public global objects]===============
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+//=====[Declaration and initialization of private global variables]============
+
+static timeSyncExchange_t exchanges[PC_SERIAL_COM_NUMBER_OF_SESSIONS];
+static timeSyncStatus_t timeSyncStatus = {
+    false, 0, 0, 0, 0, INT32_MAX, 0, 0,
+};
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void timeSyncSampleProcess( const timeSyncExchange_t* exchange,
+                                   int64_t t4_us );
+static int64_t timeSyncClamp( int64_t value, int64_t limit );
+
+//=====[Implementations of public functions]===================================
+
+// One NTP-style exchange per request. The host sends t1, its clock when
+// sending, and previousT4, its clock when the answer to its previous request
+// arrived (0 if none). That completes the previous exchange, which is turned
+// into an offset sample before this one is stamped: t2 is the panel clock
+// when the request's last byte arrived and t3 when the answer is built.
+void timeSyncExchange( int sessionId, int64_t t1_us, int64_t previousT4_us,
+                       uint64_t receiveMonotonic_us, timeSyncStamps_t* stamps )
+{
+    timeSyncExchange_t* exchange = &exchanges[sessionId];
+
+    if ( exchange->pending && previousT4_us != 0 ) {
+        timeSyncSampleProcess( exchange, previousT4_us );
+    }
+
+    exchange->t1_us = t1_us;
+    exchange->t2_us = dateAndTimeMonotonicToEpochUs( receiveMonotonic_us );
+    exchange->t3_us = dateAndTimeEpochUsRead();
+    exchange->pending = true;
+
+    stamps->t2_us = exchange->t2_us;
+    stamps->t3_us = exchange->t3_us;
+}
+
+void timeSyncStatusRead( timeSyncStatus_t* status )
+{
+    *status = timeSyncStatus;
+    status->rate_ppb = dateAndTimeRateRead();
+}
+
+//=====[Implementations of private functions]==================================
+
+// offset is how far the panel clock is behind the host's and delay the
+// round trip without the panel's own processing time. The first sample, or
+// a large offset, is stepped out. After that the clock is only corrected
+// once TIME_SYNC_MIN_INTERVAL_US has passed since the previous correction:
+// the offset is then what it drifted over that interval, so half of it, as
+// a rate, goes to the frequency correction, and the phase is stepped out.
+// Samples in between only feed the delay filter and the status.
+static void timeSyncSampleProcess( const timeSyncExchange_t* exchange,
+                                   int64_t t4_us )
+{
+    int64_t offset_us = ( ( exchange->t1_us - exchange->t2_us ) +
+                          ( t4_us - exchange->t3_us ) ) / 2;
+    int64_t delay_us = ( t4_us - exchange->t1_us ) -
+                       ( exchange->t3_us - exchange->t2_us );
+    uint64_t monotonic_us = dateAndTimeMonotonicRead();
+    int64_t interval_us;
+    int64_t rate_ppb = dateAndTimeRateRead();
+
+    if ( delay_us < 0 ) {
+        timeSyncStatus.rejectedSamples++;
+        return;
+    }
+    // The best delay ages so that a slower link is accepted in the end
+    if ( delay_us < timeSyncStatus.minDelay_us ) {
+        timeSyncStatus.minDelay_us = (int32_t)delay_us;
+    } else {
+        timeSyncStatus.minDelay_us += timeSyncStatus.minDelay_us / 64 + 1;
+        if ( delay_us > (int64_t)timeSyncStatus.minDelay_us +
+                        TIME_SYNC_DELAY_MARGIN_US ) {
+            timeSyncStatus.rejectedSamples++;
+            return;
+        }
+    }
+
+    timeSyncStatus.samples++;
+    timeSyncStatus.lastOffset_us = (int32_t)timeSyncClamp( offset_us, INT32_MAX );
+    timeSyncStatus.lastDelay_us = (int32_t)timeSyncClamp( delay_us, INT32_MAX );
+
+    if ( !timeSyncStatus.synchronized ||
+         offset_us > TIME_SYNC_STEP_THRESHOLD_US ||
+         offset_us < -TIME_SYNC_STEP_THRESHOLD_US ) {
+        dateAndTimeAdjust( offset_us, (int32_t)rate_ppb );
+        timeSyncStatus.synchronized = true;
+        timeSyncStatus.lastAdjustMonotonic_us = monotonic_us;
+        return;
+    }
+
+    interval_us = (int64_t)( monotonic_us - timeSyncStatus.lastAdjustMonotonic_us );
+    if ( interval_us < TIME_SYNC_MIN_INTERVAL_US ) {
+        return;
+    }
+    rate_ppb += offset_us * 1000000000 / interval_us / 2;
+    rate_ppb = timeSyncClamp( rate_ppb, TIME_SYNC_MAX_RATE_PPB );
+    dateAndTimeAdjust( offset_us, (int32_t)rate_ppb );
+    timeSyncStatus.lastAdjustMonotonic_us = monotonic_us;
+}
+
+static int64_t timeSyncClamp( int64_t value, int64_t limit )
+{
+    if ( value > limit ) {
+        return limit;
+    }
+    if ( value < -limit ) {
+        return -limit;
+    }
+    return value;
+}
@@ -0,0 +1,42 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _TIME_SYNC_H_
+#define _TIME_SYNC_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+// Larger offsets are stepped out at once, keeping the drift estimate
+#define TIME_SYNC_STEP_THRESHOLD_US    128000
+#define TIME_SYNC_MAX_RATE_PPB         500000
+
+//=====[Declaration of public data types]======================================
+
+typedef struct timeSyncStamps {
+    int64_t t2_us;
+    int64_t t3_us;
+} timeSyncStamps_t;
+
+typedef struct timeSyncStatus {
+    bool synchronized;
+    uint32_t samples;
+    uint32_t rejectedSamples;
+    int32_t lastOffset_us;
+    int32_t lastDelay_us;
+    int32_t minDelay_us;
+    int32_t rate_ppb;
+    uint64_t lastAdjustMonotonic_us;
+} timeSyncStatus_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void timeSyncExchange( int sessionId, int64_t t1_us, int64_t previousT4_us,
+                       uint64_t receiveMonotonic_us, timeSyncStamps_t* stamps );
+void timeSyncStatusRead( timeSyncStatus_t* status );
+
+//=====[#include guards - end]=================================================
+
+#endif // _TIME_SYNC_H_
@@ -0,0 +1,118 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "trace_buffer.h"
+
+#include "pc_serial_com.h"
+
+//=====[Declaration of private defines]========================================
+
+#define TRACE_BUFFER_DUMP_MAGIC    0x31435254    // "TRC1"
+
+//=====[Declaration of private data types]=====================================
+
+// Precedes the records in a dump; all fields little endian
+typedef struct traceBufferDumpHeader {
+    uint32_t magic;
+    uint32_t recordSize;
+    uint32_t numberOfRecords;
+    uint32_t cyclesPerSecond;
+    uint32_t droppedRecords;
+} traceBufferDumpHeader_t;
+
+//=====[Declaration and initialization of public global objects]===============
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+traceBufferRecord_t traceBufferRecords[TRACE_BUFFER_NUMBER_OF_RECORDS];
+uint32_t traceBufferHead = 0;
+volatile bool traceBufferFrozen = false;
+
+//=====[Declaration and initialization of private global variables]============
+
+static traceBufferDumpHeader_t traceBufferDumpHeader;
+static pcSerialComChunk_t traceBufferDumpChunks[3];
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void traceBufferDumpDone();
+
+//=====[Implementations of public functions]===================================
+
+// Starts the Cortex-M cycle counter the records are stamped with. It stops
+// while the core sleeps, so TRACE_EVENT_TIME_SYNC records carry the
+// monotonic time as well.
+void traceBufferInit()
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+// Sends the header and the records held, oldest first, as one binary bulk
+// transfer. Tracing is paused until it is over, as the records are sent in
+// place. Returns false if the session is already sending a transfer.
+bool traceBufferDump( int sessionId )
+{
+    uint32_t numberOfRecords = traceBufferHead;
+    uint32_t first;
+    int numberOfChunks = 1;
+
+    if ( traceBufferFrozen ) {
+        return false;
+    }
+    traceBufferFrozen = true;
+
+    if ( numberOfRecords > TRACE_BUFFER_NUMBER_OF_RECORDS ) {
+        numberOfRecords = TRACE_BUFFER_NUMBER_OF_RECORDS;
+    }
+    first = ( traceBufferHead - numberOfRecords ) &
+            ( TRACE_BUFFER_NUMBER_OF_RECORDS - 1 );
+
+    traceBufferDumpHeader.magic = TRACE_BUFFER_DUMP_MAGIC;
+    traceBufferDumpHeader.recordSize = sizeof( traceBufferRecord_t );
+    traceBufferDumpHeader.numberOfRecords = numberOfRecords;
+    traceBufferDumpHeader.cyclesPerSecond = SystemCoreClock;
+    traceBufferDumpHeader.droppedRecords = traceBufferHead - numberOfRecords;
+    traceBufferDumpChunks[0].data = (const char*)&traceBufferDumpHeader;
+    traceBufferDumpChunks[0].length = sizeof( traceBufferDumpHeader );
+
+    // The oldest records run up to the end of the array, the rest wrap
+    if ( numberOfRecords > 0 ) {
+        uint32_t untilEnd = TRACE_BUFFER_NUMBER_OF_RECORDS - first;
+        if ( untilEnd > numberOfRecords ) {
+            untilEnd = numberOfRecords;
+        }
+        traceBufferDumpChunks[1].data = (const char*)&traceBufferRecords[first];
+        traceBufferDumpChunks[1].length = untilEnd * sizeof( traceBufferRecord_t );
+        numberOfChunks++;
+        if ( untilEnd < numberOfRecords ) {
+            traceBufferDumpChunks[2].data = (const char*)&traceBufferRecords[0];
+            traceBufferDumpChunks[2].length =
+                ( numberOfRecords - untilEnd ) * sizeof( traceBufferRecord_t );
+            numberOfChunks++;
+        }
+    }
+
+    if ( !pcSerialComBulkBinaryWrite( (pcSerialComSessionId_t)sessionId,
+                                      traceBufferDumpChunks, numberOfChunks,
+                                      &traceBufferDumpDone ) ) {
+        traceBufferFrozen = false;
+        return false;
+    }
+    return true;
+}
+
+//=====[Implementations of private functions]==================================
+
+// Called from interrupt context. The dumped records are dropped so that the
+// next dump only holds what happened since.
+static void traceBufferDumpDone()
+{
+    traceBufferHead = 0;
+    traceBufferFrozen = false;
+}
@@ -0,0 +1,87 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _TRACE_BUFFER_H_
+#define _TRACE_BUFFER_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include "mbed.h"
+
+//=====[Declaration of public defines]=========================================
+
+// Tracing costs nothing unless enabled here or on the command line
+#ifndef TRACE_BUFFER_ENABLED
+#define TRACE_BUFFER_ENABLED    0
+#endif
+
+// A power of two
+#define TRACE_BUFFER_NUMBER_OF_RECORDS    512
+
+#if TRACE_BUFFER_ENABLED
+#define TRACE_BUFFER_WRITE( event, argument ) \
+    traceBufferWrite( (event), (uint32_t)(argument) )
+#else
+#define TRACE_BUFFER_WRITE( event, argument )    ((void)0)
+#endif
+
+//=====[Declaration of public data types]======================================
+
+// Keep in step with EVENT_NAMES in tools/trace_to_chrome.py
+typedef enum {
+    TRACE_EVENT_TIME_SYNC,          // monotonic time, in us (low 32 bits)
+    TRACE_EVENT_TASK_BEGIN,         // systemWatchdogTask_t
+    TRACE_EVENT_TASK_END,           // systemWatchdogTask_t
+    TRACE_EVENT_STANDBY_BEGIN,      // 0
+    TRACE_EVENT_STANDBY_END,        // 1 if woken by an event
+    TRACE_EVENT_KEYPAD_SCAN_BEGIN,  // 0
+    TRACE_EVENT_KEYPAD_SCAN_END,    // 0
+    TRACE_EVENT_KEYPAD_KEY,         // key << 8 | pressed
+    TRACE_EVENT_SERIAL_COMMAND,     // session << 8 | command key
+    TRACE_EVENT_SERIAL_FLOW_BEGIN,  // session
+    TRACE_EVENT_SERIAL_FLOW_END,    // session
+    TRACE_EVENT_OUTPUT_CHANGE,      // outputManagerOutput_t << 1 | level
+} traceBufferEvent_t;
+
+typedef struct traceBufferRecord {
+    uint32_t cycles;
+    uint32_t event;
+    uint32_t argument;
+} traceBufferRecord_t;
+
+//=====[Declaration of external public global variables]=======================
+
+extern traceBufferRecord_t traceBufferRecords[TRACE_BUFFER_NUMBER_OF_RECORDS];
+extern uint32_t traceBufferHead;
+extern volatile bool traceBufferFrozen;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void traceBufferInit();
+bool traceBufferDump( int sessionId );
+
+//=====[Implementations of public inline functions]============================
+
+// Inline, and only through TRACE_BUFFER_WRITE(), so a record costs a few
+// loads and stores: the DWT cycle counter, the record and the head. Call
+// it from the superloop only, which is the single writer.
+static inline void traceBufferWrite( traceBufferEvent_t event,
+                                     uint32_t argument )
+{
+    traceBufferRecord_t* record;
+
+    if ( traceBufferFrozen ) {
+        return;
+    }
+    record = &traceBufferRecords[traceBufferHead &
+                                 ( TRACE_BUFFER_NUMBER_OF_RECORDS - 1 )];
+    record->cycles = DWT->CYCCNT;
+    record->event = event;
+    record->argument = argument;
+    traceBufferHead++;
+}
+
+//=====[#include guards - end]=================================================
+
+#endif // _TRACE_BUFFER_H_
@@ -0,0 +1,281 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+#include "kvstore_global_api.h"
+
+#include "user_codes.h"
+
+#include "code.h"
+#include "date_and_time.h"
+
+//=====[Declaration of private defines]========================================
+
+#define USER_CODES_KVSTORE_KEY    "/kv/user_codes"
+
+// Raise whenever the stored image or the hash function changes
+#define USER_CODES_VERSION        2
+
+// Edits are written to flash together once none has come for this long, so
+// that a batch of useradd/userdel rewrites the image once, not per edit
+#define USER_CODES_SAVE_DELAY_MS  2000
+
+#define USER_CODES_EMPTY_SLOT     0xFFFF
+#define USER_CODES_TABLE_MASK     (USER_CODES_TABLE_SIZE - 1)
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct userCodeEntry {
+    uint16_t userId;
+    char code[CODE_NUMBER_OF_KEYS];
+} userCodeEntry_t;
+
+// Linear probing hash table keyed by the code. The slots are stored in flash
+// as they are, so loading needs no rebuild.
+typedef struct userCodesImage {
+    uint32_t version;
+    uint32_t tableSize;
+    userCodeEntry_t slots[USER_CODES_TABLE_SIZE];
+} userCodesImage_t;
+
+//=====[Declaration and initialization of public global objects]===============
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+//=====[Declaration and initialization of private global variables]============
+
+static userCodesImage_t userCodes;
+static int numberOfUsers = 0;
+static bool userCodesStored = false;
+static bool userCodesEdited = false;
+static uint64_t lastEditTime_us = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void userCodesClear();
+static int userCodesHomeSlot( const char* code );
+static int userCodesSlotOfUser( int userId );
+static void userCodesSlotRemove( int slot );
+static void userCodesEditRecord();
+
+//=====[Implementations of public functions]===================================
+
+void userCodesInit()
+{
+    size_t actualSize = 0;
+    int slot;
+
+    userCodesStored =
+        kv_get( USER_CODES_KVSTORE_KEY, &userCodes, sizeof(userCodes),
+                &actualSize ) == MBED_SUCCESS &&
+        actualSize == sizeof(userCodes) &&
+        userCodes.version == USER_CODES_VERSION &&
+        userCodes.tableSize == USER_CODES_TABLE_SIZE;
+
+    if ( !userCodesStored ) {
+        userCodesClear();
+        return;
+    }
+    numberOfUsers = 0;
+    for ( slot = 0; slot < USER_CODES_TABLE_SIZE; slot++ ) {
+        if ( userCodes.slots[slot].userId != USER_CODES_EMPTY_SLOT ) {
+            numberOfUsers++;
+        }
+    }
+}
+
+// Returns the user the code belongs to, or USER_CODES_NO_USER. Only the
+// few slots of one probe run are visited, whatever the number of users; the
+// probe count is bounded all the same, in case the table was corrupted.
+int userCodesFind( const char* code )
+{
+    int slot = userCodesHomeSlot( code );
+    const userCodeEntry_t* entry;
+    int probe;
+
+    for ( probe = 0; probe < USER_CODES_TABLE_SIZE; probe++ ) {
+        entry = &userCodes.slots[slot];
+        if ( entry->userId == USER_CODES_EMPTY_SLOT ) {
+            return USER_CODES_NO_USER;
+        }
+        if ( userCodesEqual( entry->code, code ) ) {
+            return entry->userId;
+        }
+        slot = ( slot + 1 ) & USER_CODES_TABLE_MASK;
+    }
+    return USER_CODES_NO_USER;
+}
+
+// Gives userId the code, replacing the code it had. The table is written to
+// flash later by userCodesUpdate().
+userCodesResult_t userCodesAdd( int userId, const char* code )
+{
+    int owner;
+    int slot;
+    int probe;
+
+    if ( userId <= USER_CODES_MASTER_USER || userId > USER_CODES_MAX_USER_ID ||
+         !codeSequenceCheck( code ) ) {
+        return USER_CODES_INVALID;
+    }
+    // The master code belongs to user 0, even though it is not in the table
+    owner = codeMasterCheck( code ) ? USER_CODES_MASTER_USER :
+                                      userCodesFind( code );
+    if ( owner != USER_CODES_NO_USER && owner != userId ) {
+        return USER_CODES_CODE_IN_USE;
+    }
+    slot = userCodesSlotOfUser( userId );
+    if ( slot < 0 && numberOfUsers >= USER_CODES_MAX_USERS ) {
+        return USER_CODES_TABLE_FULL;
+    }
+
+    if ( slot >= 0 ) {
+        userCodesSlotRemove( slot );
+        numberOfUsers--;
+    }
+    // Below USER_CODES_MAX_USERS there is always an empty slot to reach
+    slot = userCodesHomeSlot( code );
+    for ( probe = 0; probe < USER_CODES_TABLE_SIZE &&
+                     userCodes.slots[slot].userId != USER_CODES_EMPTY_SLOT;
+          probe++ ) {
+        slot = ( slot + 1 ) & USER_CODES_TABLE_MASK;
+    }
+    if ( probe == USER_CODES_TABLE_SIZE ) {
+        return USER_CODES_TABLE_FULL;
+    }
+    userCodes.slots[slot].userId = userId;
+    memcpy( userCodes.slots[slot].code, code, CODE_NUMBER_OF_KEYS );
+    numberOfUsers++;
+    userCodesEditRecord();
+    return USER_CODES_OK;
+}
+
+userCodesResult_t userCodesRemove( int userId )
+{
+    int slot = userCodesSlotOfUser( userId );
+
+    if ( slot < 0 ) {
+        return USER_CODES_UNKNOWN_USER;
+    }
+    userCodesSlotRemove( slot );
+    numberOfUsers--;
+    userCodesEditRecord();
+    return USER_CODES_OK;
+}
+
+// Writes the edited table to flash once the edits have stopped coming for
+// USER_CODES_SAVE_DELAY_MS. A failed write is not retried until the next
+// edit, and userCodesStoredRead() reports it.
+void userCodesUpdate()
+{
+    if ( !userCodesEdited || dateAndTimeMonotonicRead() - lastEditTime_us <
+                             (uint64_t)USER_CODES_SAVE_DELAY_MS * 1000 ) {
+        return;
+    }
+    userCodesEdited = false;
+    userCodesStored =
+        kv_set( USER_CODES_KVSTORE_KEY, &userCodes, sizeof(userCodes), 0 ) ==
+        MBED_SUCCESS;
+}
+
+// When userCodesUpdate() will store the pending edits, or UINT64_MAX when
+// there are none
+uint64_t userCodesDeadlineRead()
+{
+    if ( !userCodesEdited ) {
+        return UINT64_MAX;
+    }
+    return lastEditTime_us + (uint64_t)USER_CODES_SAVE_DELAY_MS * 1000;
+}
+
+// True when the table in use is the one stored in flash
+bool userCodesStoredRead()
+{
+    return userCodesStored;
+}
+
+int userCodesNumberOfUsersRead()
+{
+    return numberOfUsers;
+}
+
+// Takes the same time whichever key differs, so the time taken by a wrong
+// code tells nothing about how close it was
+bool userCodesEqual( const char* code1, const char* code2 )
+{
+    char difference = 0;
+    int i;
+
+    for ( i = 0; i < CODE_NUMBER_OF_KEYS; i++ ) {
+        difference |= code1[i] ^ code2[i];
+    }
+    return difference == 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void userCodesClear()
+{
+    int slot;
+
+    userCodes.version = USER_CODES_VERSION;
+    userCodes.tableSize = USER_CODES_TABLE_SIZE;
+    for ( slot = 0; slot < USER_CODES_TABLE_SIZE; slot++ ) {
+        userCodes.slots[slot].userId = USER_CODES_EMPTY_SLOT;
+    }
+    numberOfUsers = 0;
+}
+
+// FNV-1a over the keys of the code
+static int userCodesHomeSlot( const char* code )
+{
+    uint32_t hash = 2166136261u;
+    int i;
+
+    for ( i = 0; i < CODE_NUMBER_OF_KEYS; i++ ) {
+        hash = ( hash ^ (uint8_t)code[i] ) * 16777619u;
+    }
+    return hash & USER_CODES_TABLE_MASK;
+}
+
+// Only used when the table is edited, so a full scan is acceptable here
+static int userCodesSlotOfUser( int userId )
+{
+    int slot;
+
+    for ( slot = 0; slot < USER_CODES_TABLE_SIZE; slot++ ) {
+        if ( userCodes.slots[slot].userId == userId ) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+// Backward shift deletion: entries of the probe run after the hole are
+// moved back into it when their home slot allows, so that no lookup stops
+// early at the hole and no tombstones are needed
+static void userCodesSlotRemove( int slot )
+{
+    int next = ( slot + 1 ) & USER_CODES_TABLE_MASK;
+    int home;
+
+    while ( userCodes.slots[next].userId != USER_CODES_EMPTY_SLOT ) {
+        home = userCodesHomeSlot( userCodes.slots[next].code );
+        if ( ( ( next - home ) & USER_CODES_TABLE_MASK ) >=
+             ( ( next - slot ) & USER_CODES_TABLE_MASK ) ) {
+            userCodes.slots[slot] = userCodes.slots[next];
+            slot = next;
+        }
+        next = ( next + 1 ) & USER_CODES_TABLE_MASK;
+    }
+    userCodes.slots[slot].userId = USER_CODES_EMPTY_SLOT;
+}
+
+static void userCodesEditRecord()
+{
+    userCodesStored = false;
+    userCodesEdited = true;
+    lastEditTime_us = dateAndTimeMonotonicRead();
+}
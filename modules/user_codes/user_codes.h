@@ -0,0 +1,47 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _USER_CODES_H_
+#define _USER_CODES_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+// The hash table is kept at most three quarters full, so a lookup never
+// probes far and always reaches an empty slot. With every user in place a
+// random code belongs to someone 1536 times in 10^CODE_NUMBER_OF_KEYS, so
+// the five tries before the lockout succeed less than 1% of the time.
+#define USER_CODES_TABLE_SIZE    2048
+#define USER_CODES_MAX_USERS     1536
+
+#define USER_CODES_NO_USER         -1
+#define USER_CODES_MASTER_USER      0
+#define USER_CODES_MAX_USER_ID  65534
+
+//=====[Declaration of public data types]======================================
+
+typedef enum {
+    USER_CODES_OK,
+    USER_CODES_INVALID,
+    USER_CODES_CODE_IN_USE,
+    USER_CODES_TABLE_FULL,
+    USER_CODES_UNKNOWN_USER,
+} userCodesResult_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void userCodesInit();
+int userCodesFind( const char* code );
+userCodesResult_t userCodesAdd( int userId, const char* code );
+userCodesResult_t userCodesRemove( int userId );
+void userCodesUpdate();
+uint64_t userCodesDeadlineRead();
+bool userCodesStoredRead();
+int userCodesNumberOfUsersRead();
+bool userCodesEqual( const char* code1, const char* code2 );
+
+//=====[#include guards - end]=================================================
+
+#endif // _USER_CODES_H_
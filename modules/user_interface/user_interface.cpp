@@ -12,6 +12,7 @@
 #include "temperature_sensor.h"
 #include "gas_sensor.h"
 #include "matrix_keypad.h"
+#include "output_manager.h"
 
 //=====[Declaration of private defines]========================================
 
@@ -19,9 +20,6 @@
 
 //=====[Declaration and initialization of public global objects]===============
 
-DigitalOut incorrectCodeLed(LED3);
-DigitalOut systemBlockedLed(LED2);
-
 //=====[Declaration of external public global variables]=======================
 
 //=====[Declaration and initialization of public global variables]=============
@@ -46,8 +44,8 @@ static void systemBlockedIndicatorUpdate();
 
 void userInterfaceInit()
 {
-    incorrectCodeLed = OFF;
-    systemBlockedLed = OFF;
+    outputManagerWrite( OUTPUT_INCORRECT_CODE_LED, OFF );
+    outputManagerWrite( OUTPUT_SYSTEM_BLOCKED_LED, OFF );
     matrixKeypadInit( SYSTEM_TIME_INCREMENT_MS );
 }
 
@@ -90,12 +88,28 @@ void userInterfaceCodeCompleteWrite( bool state )
 
 //=====[Implementations of private functions]==================================
 
+// Every release queued since the last pass is handled, so keys typed
+// quickly, or several at once, are not lost. Once a code is complete the
+// rest stay queued until the fire alarm has checked it, so that keys typed
+// after a code are handled in the state it leads to (incorrect code or not).
 static void userInterfaceMatrixKeypadUpdate()
 {
     static int numberOfHashKeyReleased = 0;
-    char keyReleased = matrixKeypadUpdate();
+    matrixKeypadEvent_t keyEvent;
+    char keyReleased;
+
+    matrixKeypadUpdate();
 
-    if( keyReleased != '\0' ) {
+    // Nothing checks a code once the alarm is off, so drop it
+    if( codeComplete && !sirenStateRead() ) {
+        codeComplete = false;
+    }
+
+    while( !codeComplete && matrixKeypadEventRead( &keyEvent ) ) {
+        if( keyEvent.pressed ) {
+            continue;
+        }
+        keyReleased = keyEvent.key;
 
         if( sirenStateRead() && !systemBlockedStateRead() ) {
             if( !incorrectCodeStateRead() ) {
@@ -122,10 +136,10 @@ static void userInterfaceMatrixKeypadUpdate()
 
 static void incorrectCodeIndicatorUpdate()
 {
-    incorrectCodeLed = incorrectCodeStateRead();
+    outputManagerWrite( OUTPUT_INCORRECT_CODE_LED, incorrectCodeStateRead() );
 }
 
 static void systemBlockedIndicatorUpdate()
 {
-    systemBlockedLed = systemBlockedState;
+    outputManagerWrite( OUTPUT_SYSTEM_BLOCKED_LED, systemBlockedState );
 }
\ No newline at end of file
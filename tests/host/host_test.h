@@ -0,0 +1,41 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _HOST_TEST_H_
+#define _HOST_TEST_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//=====[Declaration of public defines]=========================================
+
+// Host tests are plain programs: a failed check prints where it failed and
+// the test exits with a non-zero status at the end
+#define HOST_TEST_CHECK( condition ) \
+    hostTestCheck( ( condition ), #condition, __FILE__, __LINE__ )
+
+//=====[Declaration and initialization of private global variables]============
+
+static int hostTestFailures = 0;
+
+//=====[Implementations of public inline functions]============================
+
+static inline void hostTestCheck( bool passed, const char* condition,
+                                  const char* file, int line )
+{
+    if ( !passed ) {
+        printf( "%s:%d: check failed: %s\n", file, line, condition );
+        hostTestFailures++;
+    }
+}
+
+static inline int hostTestResult( const char* name )
+{
+    printf( "%s: %s\n", name, hostTestFailures == 0 ? "passed" : "FAILED" );
+    return hostTestFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//=====[#include guards - end]=================================================
+
+#endif // _HOST_TEST_H_
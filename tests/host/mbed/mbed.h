@@ -0,0 +1,206 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _MBED_H_
+#define _MBED_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+//=====[Declaration of public defines]=========================================
+
+// Host stand-in for the part of mbed-os the host tests compile against.
+// Interrupts are modelled by one recursive lock: whatever plays an
+// interrupt (a serial port's RX or TX, a Timeout expiring) runs holding
+// it, and so does a critical section, so they exclude each other as they
+// do on the single-core MCU.
+
+//=====[Declaration of public data types]======================================
+
+typedef enum {
+    USBTX, USBRX, PD_5, PA_3, PE_7, PE_8, PG_12, NC, HOST_NUMBER_OF_PINS,
+} PinName;
+
+template <typename Signature>
+using Callback = std::function<Signature>;
+
+// Single-byte transmit and receive registers. The test plays the other end
+// with hostReceive() and hostTransmit(), or through the pseudo terminal
+// opened by hostPtyOpen().
+class SerialBase {
+public:
+    enum IrqType { RxIrq = 0, TxIrq, IrqCnt };
+    enum Parity { None = 0, Odd, Even, Forced1, Forced0 };
+
+    SerialBase( PinName tx, PinName rx, int baud );
+    ~SerialBase();
+
+    SerialBase( const SerialBase& ) = delete;
+    SerialBase& operator=( const SerialBase& ) = delete;
+
+    void baud( int baudRate );
+    void format( int bits, Parity parity, int stopBits );
+    int readable();
+    int writeable();
+    void attach( Callback<void()> func, IrqType type = RxIrq );
+
+    // Host side
+    void hostReceive( const uint8_t* data, int length );
+    std::string hostTransmit( int maxNumberOfBytes );
+    const char* hostPtyOpen();
+
+protected:
+    int _base_getc();
+    int _base_putc( int c );
+
+private:
+    void hostIrqRun( IrqType type );
+    void hostTxShift();
+    void hostPtyService();
+
+    PinName txPin;
+    std::deque<uint8_t> rxData;
+    bool txRegisterFull;
+    uint8_t txRegister;
+    std::string txData;
+    Callback<void()> irqs[IrqCnt];
+
+    int ptyFd;
+    char ptyName[64];
+    std::atomic<bool> ptyStop;
+    std::thread ptyThread;
+};
+
+class UnbufferedSerial : public SerialBase {
+public:
+    UnbufferedSerial( PinName tx, PinName rx, int baud = 9600 )
+        : SerialBase( tx, rx, baud ) {}
+    ssize_t read( void* buffer, size_t size );
+    ssize_t write( const void* buffer, size_t size );
+};
+
+// An edge interrupt on a pin. The test plays a falling edge with
+// hostFall(), which runs the callback as an interrupt if it is enabled.
+class InterruptIn {
+public:
+    InterruptIn( PinName pin );
+    ~InterruptIn();
+
+    InterruptIn( const InterruptIn& ) = delete;
+    InterruptIn& operator=( const InterruptIn& ) = delete;
+
+    void fall( Callback<void()> func );
+    void enable_irq();
+    void disable_irq();
+
+    // Host side
+    void hostFall();
+
+private:
+    PinName pin;
+    Callback<void()> fallFunction;
+    bool irqEnabled;
+};
+
+// Pin functions are not modelled: giving a pin back to a peripheral does
+// nothing
+typedef struct {
+    PinName pin;
+    int peripheral;
+    int function;
+} PinMap;
+
+class DigitalOut {
+public:
+    DigitalOut( PinName pin, int value = 0 ) : level( value ) { (void)pin; }
+    void write( int value ) { level = value; }
+    int read() { return level; }
+    DigitalOut& operator=( int value ) { write( value ); return *this; }
+    operator int() { return read(); }
+
+private:
+    volatile int level;
+};
+
+// Runs the callback from its own thread, as an interrupt, once the delay
+// has passed. Attaching again or detaching before then cancels it.
+class Timeout {
+public:
+    Timeout();
+    ~Timeout();
+
+    Timeout( const Timeout& ) = delete;
+    Timeout& operator=( const Timeout& ) = delete;
+
+    void attach( Callback<void()> func, std::chrono::microseconds delay );
+    void detach();
+
+private:
+    void hostService();
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    Callback<void()> function;
+    std::chrono::steady_clock::time_point deadline;
+    uint32_t generation;
+    bool armed;
+    bool stop;
+    std::thread thread;
+};
+
+// The cycle counter read by the trace buffer; it stands still on the host
+typedef struct hostDwt {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} hostDwt_t;
+
+//=====[Declaration of external public global variables]=======================
+
+extern hostDwt_t hostDwt;
+#define DWT    (&hostDwt)
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void core_util_critical_section_enter();
+void core_util_critical_section_exit();
+
+// The lock interrupts run with, for tests that play an interrupt themselves
+std::recursive_mutex& hostInterruptLock();
+
+// The serial port a module created on that TX pin, or nullptr
+SerialBase* hostSerialFind( PinName tx );
+
+// The InterruptIn a module created on that pin, or nullptr
+InterruptIn* hostInterruptInFind( PinName pin );
+
+const PinMap* serial_rx_pinmap();
+void pinmap_pinout( PinName pin, const PinMap* map );
+
+//=====[Implementations of public inline functions]============================
+
+template <typename T, typename U>
+Callback<void()> callback( void (*func)( T* ), U* argument )
+{
+    return [func, argument]() { func( argument ); };
+}
+
+static inline Callback<void()> callback( void (*func)() )
+{
+    return Callback<void()>( func );
+}
+
+//=====[#include guards - end]=================================================
+
+#endif // _MBED_H_
@@ -0,0 +1,369 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+//=====[Declaration of private defines]========================================
+
+#define HOST_PTY_POLL_TIMEOUT_MS    1
+
+//=====[Declaration and initialization of public global variables]=============
+
+hostDwt_t hostDwt = { 0, 0 };
+
+//=====[Declaration and initialization of private global variables]============
+
+static SerialBase* hostSerials[HOST_NUMBER_OF_PINS];
+static InterruptIn* hostInterruptIns[HOST_NUMBER_OF_PINS];
+
+//=====[Implementations of public functions]===================================
+
+std::recursive_mutex& hostInterruptLock()
+{
+    static std::recursive_mutex lock;
+    return lock;
+}
+
+void core_util_critical_section_enter()
+{
+    hostInterruptLock().lock();
+}
+
+void core_util_critical_section_exit()
+{
+    hostInterruptLock().unlock();
+}
+
+SerialBase* hostSerialFind( PinName tx )
+{
+    return hostSerials[tx];
+}
+
+InterruptIn* hostInterruptInFind( PinName pin )
+{
+    return hostInterruptIns[pin];
+}
+
+const PinMap* serial_rx_pinmap()
+{
+    static const PinMap map[] = { { NC, 0, 0 } };
+    return map;
+}
+
+void pinmap_pinout( PinName pin, const PinMap* map )
+{
+    (void)pin;
+    (void)map;
+}
+
+SerialBase::SerialBase( PinName tx, PinName rx, int baud )
+    : txPin( tx ), txRegisterFull( false ), txRegister( 0 ), ptyFd( -1 ),
+      ptyStop( false )
+{
+    (void)rx;
+    (void)baud;
+    ptyName[0] = '\0';
+    hostSerials[tx] = this;
+}
+
+SerialBase::~SerialBase()
+{
+    hostSerials[txPin] = nullptr;
+    if ( ptyThread.joinable() ) {
+        ptyStop = true;
+        ptyThread.join();
+    }
+    if ( ptyFd >= 0 ) {
+        close( ptyFd );
+    }
+}
+
+void SerialBase::baud( int baudRate )
+{
+    (void)baudRate;
+}
+
+void SerialBase::format( int bits, Parity parity, int stopBits )
+{
+    (void)bits;
+    (void)parity;
+    (void)stopBits;
+}
+
+int SerialBase::readable()
+{
+    std::lock_guard<std::recursive_mutex> lock( hostInterruptLock() );
+    return !rxData.empty();
+}
+
+int SerialBase::writeable()
+{
+    std::lock_guard<std::recursive_mutex> lock( hostInterruptLock() );
+    return !txRegisterFull;
+}
+
+// An RX interrupt attached while bytes wait fires at once, as it would with
+// the receive register still full
+void SerialBase::attach( Callback<void()> func, IrqType type )
+{
+    std::lock_guard<std::recursive_mutex> lock( hostInterruptLock() );
+    irqs[type] = func;
+    if ( type == RxIrq && !rxData.empty() ) {
+        hostIrqRun( RxIrq );
+    }
+}
+
+// The RX interrupt fires with the bytes waiting, as it would after each
+// byte if it keeps up
+void SerialBase::hostReceive( const uint8_t* data, int length )
+{
+    std::lock_guard<std::recursive_mutex> lock( hostInterruptLock() );
+    rxData.insert( rxData.end(), data, data + length );
+    hostIrqRun( RxIrq );
+}
+
+// Shifts out up to maxNumberOfBytes, running the TX interrupt each time the
+// register empties while it is attached, and returns what went out
+std::string SerialBase::hostTransmit( int maxNumberOfBytes )
+{
+    std::lock_guard<std::recursive_mutex> lock( hostInterruptLock() );
+    std::string transmitted;
+    int i;
+
+    for ( i = 0; i < maxNumberOfBytes; i++ ) {
+        hostTxShift();
+        if ( !irqs[TxIrq] ) {
+            break;
+        }
+        hostIrqRun( TxIrq );
+    }
+    hostTxShift();
+    transmitted.swap( txData );
+    return transmitted;
+}
+
+// Returns the name of the terminal the test talks to. From then on a
+// thread moves the bytes both ways and plays the interrupts.
+const char* SerialBase::hostPtyOpen()
+{
+    struct termios settings;
+
+    ptyFd = posix_openpt( O_RDWR | O_NOCTTY );
+    if ( ptyFd < 0 || grantpt( ptyFd ) != 0 || unlockpt( ptyFd ) != 0 ||
+         ptsname_r( ptyFd, ptyName, sizeof(ptyName) ) != 0 ) {
+        return nullptr;
+    }
+    tcgetattr( ptyFd, &settings );
+    cfmakeraw( &settings );
+    tcsetattr( ptyFd, TCSANOW, &settings );
+    ptyThread = std::thread( &SerialBase::hostPtyService, this );
+    return ptyName;
+}
+
+int SerialBase::_base_getc()
+{
+    std::lock_guard<std::recursive_mutex> lock( hostInterruptLock() );
+    int c;
+
+    if ( rxData.empty() ) {
+        return -1;
+    }
+    c = rxData.front();
+    rxData.pop_front();
+    return c;
+}
+
+int SerialBase::_base_putc( int c )
+{
+    std::lock_guard<std::recursive_mutex> lock( hostInterruptLock() );
+
+    if ( txRegisterFull ) {
+        fprintf( stderr, "stand-in: write to a full TX register\n" );
+        abort();
+    }
+    txRegister = (uint8_t)c;
+    txRegisterFull = true;
+    return c;
+}
+
+void SerialBase::hostIrqRun( IrqType type )
+{
+    Callback<void()> irq = irqs[type];
+    if ( irq ) {
+        irq();
+    }
+}
+
+void SerialBase::hostTxShift()
+{
+    if ( txRegisterFull ) {
+        txData.push_back( (char)txRegister );
+        txRegisterFull = false;
+    }
+}
+
+void SerialBase::hostPtyService()
+{
+    struct pollfd descriptor = { ptyFd, POLLIN, 0 };
+    uint8_t buffer[256];
+    std::string transmitted;
+    ssize_t length;
+
+    while ( !ptyStop ) {
+        if ( poll( &descriptor, 1, HOST_PTY_POLL_TIMEOUT_MS ) > 0 &&
+             ( descriptor.revents & POLLIN ) ) {
+            length = ::read( ptyFd, buffer, sizeof(buffer) );
+            if ( length > 0 ) {
+                hostReceive( buffer, (int)length );
+            }
+        }
+        transmitted = hostTransmit( sizeof(buffer) );
+        if ( !transmitted.empty() &&
+             ::write( ptyFd, transmitted.data(), transmitted.size() ) < 0 ) {
+            break;
+        }
+    }
+}
+
+ssize_t UnbufferedSerial::read( void* buffer, size_t size )
+{
+    uint8_t* bytes = (uint8_t*)buffer;
+    size_t i;
+
+    for ( i = 0; i < size && readable(); i++ ) {
+        bytes[i] = (uint8_t)_base_getc();
+    }
+    return i;
+}
+
+ssize_t UnbufferedSerial::write( const void* buffer, size_t size )
+{
+    const uint8_t* bytes = (const uint8_t*)buffer;
+    size_t i;
+
+    for ( i = 0; i < size; i++ ) {
+        _base_putc( bytes[i] );
+    }
+    return i;
+}
+
+InterruptIn::InterruptIn( PinName pin ) : pin( pin ), irqEnabled( false )
+{
+    hostInterruptIns[pin] = this;
+}
+
+InterruptIn::~InterruptIn()
+{
+    hostInterruptIns[pin] = nullptr;
+}
+
+// Attaching enables the interrupt, as on the board
+void InterruptIn::fall( Callback<void()> func )
+{
+    std::lock_guard<std::recursive_mutex> lock( hostInterruptLock() );
+    fallFunction = func;
+    irqEnabled = true;
+}
+
+void InterruptIn::enable_irq()
+{
+    std::lock_guard<std::recursive_mutex> lock( hostInterruptLock() );
+    irqEnabled = true;
+}
+
+void InterruptIn::disable_irq()
+{
+    std::lock_guard<std::recursive_mutex> lock( hostInterruptLock() );
+    irqEnabled = false;
+}
+
+void InterruptIn::hostFall()
+{
+    std::lock_guard<std::recursive_mutex> lock( hostInterruptLock() );
+    if ( irqEnabled && fallFunction ) {
+        fallFunction();
+    }
+}
+
+Timeout::Timeout() : generation( 0 ), armed( false ), stop( false )
+{
+    thread = std::thread( &Timeout::hostService, this );
+}
+
+Timeout::~Timeout()
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        stop = true;
+    }
+    changed.notify_all();
+    thread.join();
+}
+
+void Timeout::attach( Callback<void()> func, std::chrono::microseconds delay )
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        function = func;
+        deadline = std::chrono::steady_clock::now() + delay;
+        generation++;
+        armed = true;
+    }
+    changed.notify_all();
+}
+
+void Timeout::detach()
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        generation++;
+        armed = false;
+    }
+    changed.notify_all();
+}
+
+// The callback only runs if nothing re-armed or detached the timeout while
+// this thread waited for the interrupt lock
+void Timeout::hostService()
+{
+    std::unique_lock<std::mutex> lock( mutex );
+    uint32_t firedGeneration;
+    Callback<void()> firedFunction;
+
+    while ( !stop ) {
+        if ( !armed ) {
+            changed.wait( lock );
+            continue;
+        }
+        if ( changed.wait_until( lock, deadline ) !=
+             std::cv_status::timeout ) {
+            continue;
+        }
+        if ( !armed || std::chrono::steady_clock::now() < deadline ) {
+            continue;
+        }
+        firedGeneration = generation;
+        firedFunction = function;
+        lock.unlock();
+        {
+            std::lock_guard<std::recursive_mutex> irqLock( hostInterruptLock() );
+            {
+                std::lock_guard<std::mutex> relock( mutex );
+                if ( generation == firedGeneration ) {
+                    armed = false;
+                } else {
+                    firedFunction = nullptr;
+                }
+            }
+            if ( firedFunction ) {
+                firedFunction();
+            }
+        }
+        lock.lock();
+    }
+}
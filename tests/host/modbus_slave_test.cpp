@@ -0,0 +1,459 @@
+//=====[Libraries]=============================================================
+
+#include "host_test.h"
+
+#include "mbed.h"
+
+#include "modbus_slave.h"
+
+#include "code.h"
+#include "event_log.h"
+#include "fire_alarm.h"
+#include "power_manager.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+//=====[Declaration of private defines]========================================
+
+#define SLAVE_ADDRESS        1
+#define OTHER_ADDRESS        2
+#define BROADCAST_ADDRESS    0
+
+#define FRAME_MAX_LENGTH     256
+
+// The master's own end-of-frame silence, well above the slave's t3.5 so
+// that scheduling delays on the host do not split a response
+#define RESPONSE_TIMEOUT_MS    500
+#define RESPONSE_SILENCE_MS     20
+
+#define NUMBER_OF_BACK_TO_BACK_POLLS    200
+
+//=====[Declaration and initialization of private global variables]============
+
+static int masterFd = -1;
+static fireAlarmSnapshot_t fakeSnapshot;
+static int remoteDeactivations = 0;
+static int lockoutResets = 0;
+static std::atomic<int> wakeUps( 0 );
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void modbusSlaveReadRegistersTest();
+static void modbusSlaveTemperatureSaturationTest();
+static void modbusSlaveReadDiscreteInputsTest();
+static void modbusSlaveWriteCoilTest();
+static void modbusSlaveExceptionTest();
+static void modbusSlaveIgnoredFramesTest();
+static void modbusSlaveBackToBackPollsTest();
+static void modbusSlaveStandbyTest();
+
+static int modbusMasterTransaction( const uint8_t* request, int length,
+                                    uint8_t* response );
+static int modbusMasterReadRegisters( uint8_t function, int start,
+                                      int quantity, uint16_t* values );
+static int modbusMasterRequest( uint8_t address, uint8_t function,
+                                int word1, int word2, uint8_t* response );
+static int modbusMasterResponseRead( uint8_t* response );
+static uint16_t modbusMasterCrc( const uint8_t* data, int length );
+static bool modbusMasterCrcCheck( const uint8_t* frame, int length );
+
+//=====[Implementations of public functions]===================================
+
+// The slave's UART is the stand-in's pseudo terminal, and this test is the
+// Modbus RTU master at the other end of it: every request and response goes
+// through the pty, the RX interrupt and the t3.5 frame timeout
+int main()
+{
+    SerialBase* uart = hostSerialFind( PE_8 );
+    const char* ptyName = uart != nullptr ? uart->hostPtyOpen() : nullptr;
+    struct termios settings;
+
+    HOST_TEST_CHECK( ptyName != nullptr );
+    if ( ptyName == nullptr ) {
+        return hostTestResult( "modbus_slave_test" );
+    }
+    masterFd = open( ptyName, O_RDWR | O_NOCTTY );
+    HOST_TEST_CHECK( masterFd >= 0 );
+    if ( masterFd < 0 ) {
+        return hostTestResult( "modbus_slave_test" );
+    }
+    tcgetattr( masterFd, &settings );
+    cfmakeraw( &settings );
+    tcsetattr( masterFd, TCSANOW, &settings );
+
+    fakeSnapshot.alarm = true;
+    fakeSnapshot.cause = 2;
+    fakeSnapshot.gasDetector = true;
+    fakeSnapshot.overTemperatureDetector = false;
+    fakeSnapshot.gasDetected = true;
+    fakeSnapshot.overTemperatureDetected = false;
+    fakeSnapshot.incorrectCode = false;
+    fakeSnapshot.systemBlocked = true;
+    fakeSnapshot.temperatureC = 25.37f;
+
+    modbusSlaveInit();
+    modbusSlaveReadRegistersTest();
+    modbusSlaveTemperatureSaturationTest();
+    modbusSlaveReadDiscreteInputsTest();
+    modbusSlaveWriteCoilTest();
+    modbusSlaveExceptionTest();
+    modbusSlaveIgnoredFramesTest();
+    modbusSlaveBackToBackPollsTest();
+    modbusSlaveStandbyTest();
+
+    close( masterFd );
+    return hostTestResult( "modbus_slave_test" );
+}
+
+//=====[Implementations of private functions]==================================
+
+// FC04 and FC03 serve the same map
+static void modbusSlaveReadRegistersTest()
+{
+    uint16_t values[MODBUS_SLAVE_NUMBER_OF_REGISTERS];
+    uint16_t holding[MODBUS_SLAVE_NUMBER_OF_REGISTERS];
+    modbusSlaveStats_t stats;
+
+    modbusSlaveUpdate();
+    modbusSlaveStatsRead( &stats );
+    HOST_TEST_CHECK( modbusMasterReadRegisters( 0x04, 0,
+                         MODBUS_SLAVE_NUMBER_OF_REGISTERS, values ) ==
+                     MODBUS_SLAVE_NUMBER_OF_REGISTERS );
+    HOST_TEST_CHECK( values[MODBUS_SLAVE_REG_ALARM_STATE] == 1 );
+    HOST_TEST_CHECK( values[MODBUS_SLAVE_REG_ALARM_CAUSE] == 2 );
+    HOST_TEST_CHECK( values[MODBUS_SLAVE_REG_GAS_DETECTOR] == 1 );
+    HOST_TEST_CHECK( values[MODBUS_SLAVE_REG_OVER_TEMP_DETECTOR] == 0 );
+    HOST_TEST_CHECK( values[MODBUS_SLAVE_REG_TEMPERATURE_C_X100] == 2537 );
+    HOST_TEST_CHECK( values[MODBUS_SLAVE_REG_INCORRECT_CODE] == 0 );
+    HOST_TEST_CHECK( values[MODBUS_SLAVE_REG_SYSTEM_BLOCKED] == 1 );
+    HOST_TEST_CHECK( values[MODBUS_SLAVE_REG_LOGGED_EVENTS] == 23 );
+    HOST_TEST_CHECK( values[MODBUS_SLAVE_REG_FRAMES_RECEIVED] ==
+                     (uint16_t)stats.framesReceived );
+    HOST_TEST_CHECK( values[MODBUS_SLAVE_REG_FRAME_ERRORS] == 0 );
+
+    modbusSlaveUpdate();
+    HOST_TEST_CHECK( modbusMasterReadRegisters( 0x03, 2, 3, holding ) == 3 );
+    HOST_TEST_CHECK( holding[0] == 1 && holding[1] == 0 &&
+                     holding[2] == 2537 );
+}
+
+// A reading that does not fit in 16 bits saturates instead of wrapping
+static void modbusSlaveTemperatureSaturationTest()
+{
+    uint16_t value = 0;
+
+    fakeSnapshot.temperatureC = 330.0f;
+    modbusSlaveUpdate();
+    HOST_TEST_CHECK( modbusMasterReadRegisters( 0x04,
+                         MODBUS_SLAVE_REG_TEMPERATURE_C_X100, 1, &value ) == 1 );
+    HOST_TEST_CHECK( value == 0x7FFF );
+
+    fakeSnapshot.temperatureC = -400.0f;
+    modbusSlaveUpdate();
+    HOST_TEST_CHECK( modbusMasterReadRegisters( 0x04,
+                         MODBUS_SLAVE_REG_TEMPERATURE_C_X100, 1, &value ) == 1 );
+    HOST_TEST_CHECK( value == 0x8000 );
+
+    fakeSnapshot.temperatureC = -5.5f;
+    modbusSlaveUpdate();
+    HOST_TEST_CHECK( modbusMasterReadRegisters( 0x04,
+                         MODBUS_SLAVE_REG_TEMPERATURE_C_X100, 1, &value ) == 1 );
+    HOST_TEST_CHECK( (int16_t)value == -550 );
+
+    fakeSnapshot.temperatureC = 25.37f;
+    modbusSlaveUpdate();
+}
+
+static void modbusSlaveReadDiscreteInputsTest()
+{
+    uint8_t response[FRAME_MAX_LENGTH];
+
+    HOST_TEST_CHECK( modbusMasterRequest( SLAVE_ADDRESS, 0x02, 0,
+                         MODBUS_SLAVE_NUMBER_OF_INPUTS, response ) == 6 );
+    HOST_TEST_CHECK( response[1] == 0x02 && response[2] == 1 );
+    HOST_TEST_CHECK( response[3] ==
+                     ( ( 1 << MODBUS_SLAVE_INPUT_ALARM_STATE ) |
+                       ( 1 << MODBUS_SLAVE_INPUT_GAS_DETECTED ) |
+                       ( 1 << MODBUS_SLAVE_INPUT_GAS_DETECTOR ) |
+                       ( 1 << MODBUS_SLAVE_INPUT_SYSTEM_BLOCKED ) ) );
+}
+
+// A coil write is echoed at once, reads ON until the main loop has carried
+// it out, and then reads OFF again
+static void modbusSlaveWriteCoilTest()
+{
+    uint8_t response[FRAME_MAX_LENGTH];
+
+    HOST_TEST_CHECK( modbusMasterRequest( SLAVE_ADDRESS, 0x05,
+                         MODBUS_SLAVE_COIL_ACKNOWLEDGE, 0xFF00,
+                         response ) == 8 );
+    HOST_TEST_CHECK( response[1] == 0x05 && response[2] == 0 &&
+                     response[3] == MODBUS_SLAVE_COIL_ACKNOWLEDGE &&
+                     response[4] == 0xFF && response[5] == 0x00 );
+
+    HOST_TEST_CHECK( modbusMasterRequest( SLAVE_ADDRESS, 0x01, 0,
+                         MODBUS_SLAVE_NUMBER_OF_COILS, response ) == 6 );
+    HOST_TEST_CHECK( response[3] == ( 1 << MODBUS_SLAVE_COIL_ACKNOWLEDGE ) );
+    HOST_TEST_CHECK( remoteDeactivations == 0 );
+
+    modbusSlaveUpdate();
+    HOST_TEST_CHECK( remoteDeactivations == 1 );
+    HOST_TEST_CHECK( lockoutResets == 0 );
+    HOST_TEST_CHECK( modbusMasterRequest( SLAVE_ADDRESS, 0x01, 0,
+                         MODBUS_SLAVE_NUMBER_OF_COILS, response ) == 6 );
+    HOST_TEST_CHECK( response[3] == 0 );
+
+    HOST_TEST_CHECK( modbusMasterRequest( SLAVE_ADDRESS, 0x05,
+                         MODBUS_SLAVE_COIL_LOCKOUT_RESET, 0xFF00,
+                         response ) == 8 );
+    modbusSlaveUpdate();
+    HOST_TEST_CHECK( lockoutResets == 1 );
+    HOST_TEST_CHECK( remoteDeactivations == 1 );
+}
+
+static void modbusSlaveExceptionTest()
+{
+    uint8_t response[FRAME_MAX_LENGTH];
+
+    // Illegal function
+    HOST_TEST_CHECK( modbusMasterRequest( SLAVE_ADDRESS, 0x10, 0, 1,
+                                          response ) == 5 );
+    HOST_TEST_CHECK( response[1] == 0x90 && response[2] == 0x01 );
+
+    // Past the end of the register map
+    HOST_TEST_CHECK( modbusMasterRequest( SLAVE_ADDRESS, 0x03, 8, 5,
+                                          response ) == 5 );
+    HOST_TEST_CHECK( response[1] == 0x83 && response[2] == 0x02 );
+
+    // No registers
+    HOST_TEST_CHECK( modbusMasterRequest( SLAVE_ADDRESS, 0x04, 0, 0,
+                                          response ) == 5 );
+    HOST_TEST_CHECK( response[1] == 0x84 && response[2] == 0x03 );
+
+    // A coil value other than ON or OFF
+    HOST_TEST_CHECK( modbusMasterRequest( SLAVE_ADDRESS, 0x05, 0, 0x1234,
+                                          response ) == 5 );
+    HOST_TEST_CHECK( response[1] == 0x85 && response[2] == 0x03 );
+}
+
+// Frames with a bad CRC, for another slave or broadcast get no answer; a
+// broadcast coil write is carried out all the same
+static void modbusSlaveIgnoredFramesTest()
+{
+    uint8_t request[8] = { SLAVE_ADDRESS, 0x04, 0, 0, 0, 1, 0, 0 };
+    uint8_t response[FRAME_MAX_LENGTH];
+    modbusSlaveStats_t before;
+    modbusSlaveStats_t after;
+    uint16_t crc = modbusMasterCrc( request, 6 );
+
+    modbusSlaveStatsRead( &before );
+    request[6] = ( crc & 0xFF ) ^ 0x01;
+    request[7] = crc >> 8;
+    HOST_TEST_CHECK( modbusMasterTransaction( request, 8, response ) == 0 );
+    modbusSlaveStatsRead( &after );
+    HOST_TEST_CHECK( after.frameErrors == before.frameErrors + 1 );
+    HOST_TEST_CHECK( after.framesReceived == before.framesReceived );
+
+    HOST_TEST_CHECK( modbusMasterRequest( OTHER_ADDRESS, 0x04, 0, 1,
+                                          response ) == 0 );
+    modbusSlaveStatsRead( &before );
+    HOST_TEST_CHECK( before.framesReceived == after.framesReceived );
+
+    HOST_TEST_CHECK( modbusMasterRequest( BROADCAST_ADDRESS, 0x05,
+                         MODBUS_SLAVE_COIL_ACKNOWLEDGE, 0xFF00,
+                         response ) == 0 );
+    modbusSlaveUpdate();
+    HOST_TEST_CHECK( remoteDeactivations == 2 );
+}
+
+// Polls are answered from the interrupts, without the main loop running
+static void modbusSlaveBackToBackPollsTest()
+{
+    uint16_t values[MODBUS_SLAVE_NUMBER_OF_REGISTERS];
+    modbusSlaveStats_t before;
+    modbusSlaveStats_t after;
+    int answered = 0;
+    int i;
+
+    modbusSlaveUpdate();
+    modbusSlaveStatsRead( &before );
+    for ( i = 0; i < NUMBER_OF_BACK_TO_BACK_POLLS; i++ ) {
+        if ( modbusMasterReadRegisters( 0x04, 0,
+                 MODBUS_SLAVE_NUMBER_OF_REGISTERS, values ) ==
+             MODBUS_SLAVE_NUMBER_OF_REGISTERS &&
+             values[MODBUS_SLAVE_REG_TEMPERATURE_C_X100] == 2537 ) {
+            answered++;
+        }
+    }
+    modbusSlaveStatsRead( &after );
+    HOST_TEST_CHECK( answered == NUMBER_OF_BACK_TO_BACK_POLLS );
+    HOST_TEST_CHECK( after.responses - before.responses ==
+                     NUMBER_OF_BACK_TO_BACK_POLLS );
+    HOST_TEST_CHECK( after.frameErrors == before.frameErrors );
+}
+
+// In standby the RX pin wakes the panel instead of the UART, and polls are
+// answered again once the standby ends
+static void modbusSlaveStandbyTest()
+{
+    InterruptIn* rxWakeUp = hostInterruptInFind( PE_7 );
+    uint16_t values[MODBUS_SLAVE_NUMBER_OF_REGISTERS];
+
+    HOST_TEST_CHECK( rxWakeUp != nullptr );
+    if ( rxWakeUp == nullptr ) {
+        return;
+    }
+    HOST_TEST_CHECK( modbusSlaveIdleRead() );
+    wakeUps = 0;
+    rxWakeUp->hostFall();
+    HOST_TEST_CHECK( wakeUps == 0 );
+
+    modbusSlaveStandbyEnter();
+    rxWakeUp->hostFall();
+    HOST_TEST_CHECK( wakeUps == 1 );
+    modbusSlaveStandbyExit();
+
+    wakeUps = 0;
+    rxWakeUp->hostFall();
+    HOST_TEST_CHECK( wakeUps == 0 );
+    HOST_TEST_CHECK( modbusMasterReadRegisters( 0x04, 0,
+                         MODBUS_SLAVE_NUMBER_OF_REGISTERS, values ) ==
+                     MODBUS_SLAVE_NUMBER_OF_REGISTERS );
+    HOST_TEST_CHECK( modbusSlaveIdleRead() );
+}
+
+// Sends the request and returns the length of the response, 0 if none came
+static int modbusMasterTransaction( const uint8_t* request, int length,
+                                    uint8_t* response )
+{
+    if ( write( masterFd, request, length ) != length ) {
+        return -1;
+    }
+    return modbusMasterResponseRead( response );
+}
+
+// Returns the number of registers read, or -1 on a bad or missing answer
+static int modbusMasterReadRegisters( uint8_t function, int start,
+                                      int quantity, uint16_t* values )
+{
+    uint8_t response[FRAME_MAX_LENGTH];
+    int length = modbusMasterRequest( SLAVE_ADDRESS, function, start,
+                                      quantity, response );
+    int i;
+
+    if ( length != 5 + 2 * quantity || response[1] != function ||
+         response[2] != 2 * quantity ) {
+        return -1;
+    }
+    for ( i = 0; i < quantity; i++ ) {
+        values[i] = ( response[3 + 2 * i] << 8 ) | response[4 + 2 * i];
+    }
+    return quantity;
+}
+
+// Every request of the functions the slave serves is two big-endian words
+// after the function code. The response's address and CRC are checked here.
+static int modbusMasterRequest( uint8_t address, uint8_t function,
+                                int word1, int word2, uint8_t* response )
+{
+    uint8_t request[8];
+    uint16_t crc;
+    int length;
+
+    request[0] = address;
+    request[1] = function;
+    request[2] = word1 >> 8;
+    request[3] = word1 & 0xFF;
+    request[4] = word2 >> 8;
+    request[5] = word2 & 0xFF;
+    crc = modbusMasterCrc( request, 6 );
+    request[6] = crc & 0xFF;
+    request[7] = crc >> 8;
+
+    length = modbusMasterTransaction( request, 8, response );
+    if ( length > 0 && ( response[0] != SLAVE_ADDRESS ||
+                         !modbusMasterCrcCheck( response, length ) ) ) {
+        return -1;
+    }
+    return length;
+}
+
+// A response ends with RESPONSE_SILENCE_MS without a byte
+static int modbusMasterResponseRead( uint8_t* response )
+{
+    struct pollfd descriptor = { masterFd, POLLIN, 0 };
+    int timeout_ms = RESPONSE_TIMEOUT_MS;
+    int length = 0;
+    ssize_t received;
+
+    while ( length < FRAME_MAX_LENGTH &&
+            poll( &descriptor, 1, timeout_ms ) > 0 ) {
+        received = read( masterFd, &response[length],
+                         FRAME_MAX_LENGTH - length );
+        if ( received <= 0 ) {
+            break;
+        }
+        length += received;
+        timeout_ms = RESPONSE_SILENCE_MS;
+    }
+    return length;
+}
+
+// Written bit by bit from the standard, independently of the slave's
+static uint16_t modbusMasterCrc( const uint8_t* data, int length )
+{
+    uint16_t crc = 0xFFFF;
+    int i;
+    int bit;
+
+    for ( i = 0; i < length; i++ ) {
+        crc ^= data[i];
+        for ( bit = 0; bit < 8; bit++ ) {
+            crc = ( crc & 1 ) ? ( crc >> 1 ) ^ 0xA001 : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+static bool modbusMasterCrcCheck( const uint8_t* frame, int length )
+{
+    uint16_t crc;
+
+    if ( length < 4 ) {
+        return false;
+    }
+    crc = modbusMasterCrc( frame, length - 2 );
+    return frame[length - 2] == ( crc & 0xFF ) &&
+           frame[length - 1] == ( crc >> 8 );
+}
+
+//=====[Stand-ins for the modules modbus_slave calls]==========================
+
+void fireAlarmSnapshotRead( fireAlarmSnapshot_t* snapshot )
+{
+    *snapshot = fakeSnapshot;
+}
+
+void fireAlarmRemoteDeactivate()
+{
+    remoteDeactivations++;
+}
+
+void codeLockoutReset()
+{
+    lockoutResets++;
+}
+
+// More events than the log holds, so a ring index would have wrapped
+uint32_t eventLogNumberOfLoggedEventsRead()
+{
+    return 23;
+}
+
+void powerManagerWakeUp()
+{
+    wakeUps++;
+}
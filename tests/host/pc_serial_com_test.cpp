@@ -0,0 +1,452 @@
+//=====[Libraries]=============================================================
+
+#include "host_test.h"
+
+#include "mbed.h"
+
+#include "pc_serial_com.h"
+
+#include "code.h"
+#include "date_and_time.h"
+#include "event_log.h"
+#include "fire_alarm.h"
+#include "parameters.h"
+#include "power_manager.h"
+#include "serial_tx_dma.h"
+#include "serial_protocol.h"
+#include "siren.h"
+#include "system_watchdog.h"
+#include "temperature_sensor.h"
+#include "user_codes.h"
+
+#include <algorithm>
+#include <string>
+
+//=====[Declaration of private defines]========================================
+
+// More than any output of these tests
+#define TRANSMIT_ALL    100000
+
+#define CHUNK( text )    { text, sizeof(text) - 1 }
+
+//=====[Declaration and initialization of private global variables]============
+
+static SerialBase* usb;
+static SerialBase* aux;
+static int bulkDoneCalls = 0;
+static uint64_t monotonicTime_us = 0;
+static std::string requests;
+static int wakeUps = 0;
+
+#if SERIAL_TX_DMA_ENABLED
+static Callback<void()> dmaDoneCallback;
+static bool dmaBusy = false;
+static std::string dmaSegment;
+static int dmaTransfers = 0;
+#endif
+
+//=====[Declarations (prototypes) of private functions]========================
+
+#if !SERIAL_TX_DMA_ENABLED
+static void pcSerialComMenuTest();
+static void pcSerialComBulkOrderTest();
+static void pcSerialComBulkBusyTest();
+static void pcSerialComNotificationSpliceTest();
+static void pcSerialComBinaryBulkTest();
+#endif
+static void pcSerialComBulkStringFallbackTest();
+static void pcSerialComPipelinedFramesTest();
+static void pcSerialComStandbyTest();
+static void hostReceiveAt( SerialBase* serial, const char* str,
+                           uint64_t time_us );
+static void bulkDone();
+#if SERIAL_TX_DMA_ENABLED
+static void pcSerialComDmaMenuTest();
+static void pcSerialComDmaSpliceTest();
+static void pcSerialComDmaBinaryTest();
+static std::string dmaSegmentComplete();
+static std::string usbTransmitAll();
+#endif
+
+//=====[Implementations of public functions]===================================
+
+// The console UARTs are the stand-in's in-memory serial ports: the test
+// runs the TX interrupt one byte at a time and collects what goes out.
+// Built with SERIAL_TX_DMA_ENABLED, the USB console's bulk transfers go to
+// the DMA stand-in below instead, and the DMA tests run.
+int main()
+{
+    usb = hostSerialFind( USBTX );
+    aux = hostSerialFind( PD_5 );
+    HOST_TEST_CHECK( usb != nullptr && aux != nullptr );
+    if ( usb == nullptr || aux == nullptr ) {
+        return hostTestResult( "pc_serial_com_test" );
+    }
+
+    pcSerialComInit();
+#if SERIAL_TX_DMA_ENABLED
+    pcSerialComDmaMenuTest();
+    pcSerialComDmaSpliceTest();
+    pcSerialComDmaBinaryTest();
+#else
+    pcSerialComMenuTest();
+    pcSerialComBulkOrderTest();
+    pcSerialComBulkBusyTest();
+    pcSerialComNotificationSpliceTest();
+    pcSerialComBinaryBulkTest();
+#endif
+    pcSerialComBulkStringFallbackTest();
+    pcSerialComPipelinedFramesTest();
+    pcSerialComStandbyTest();
+    return hostTestResult( SERIAL_TX_DMA_ENABLED ? "pc_serial_com_dma_test" :
+                                                   "pc_serial_com_test" );
+}
+
+//=====[Implementations of private functions]==================================
+
+#if !SERIAL_TX_DMA_ENABLED
+// The menu printed by pcSerialComInit() goes out as a bulk transfer
+static void pcSerialComMenuTest()
+{
+    pcSerialComStats_t stats;
+    std::string menu;
+
+    HOST_TEST_CHECK( pcSerialComBulkBusyRead( PC_SERIAL_COM_SESSION_USB ) );
+    menu = usb->hostTransmit( TRANSMIT_ALL );
+    HOST_TEST_CHECK( menu.compare( 0, 21, "Available commands:\r\n" ) == 0 );
+    HOST_TEST_CHECK( menu.find( "Press 'm' or 'M' to get the metrics\r\n" ) !=
+                     std::string::npos );
+    HOST_TEST_CHECK( !pcSerialComBulkBusyRead( PC_SERIAL_COM_SESSION_USB ) );
+
+    pcSerialComStatsRead( PC_SERIAL_COM_SESSION_USB, &stats );
+    HOST_TEST_CHECK( stats.bulkTransfers == 1 );
+    HOST_TEST_CHECK( stats.txBytes == menu.size() );
+
+    // Each session has its own copy
+    HOST_TEST_CHECK( aux->hostTransmit( TRANSMIT_ALL ) == menu );
+    HOST_TEST_CHECK( pcSerialComIdleRead() );
+}
+
+// A bulk transfer keeps its place among the strings queued around it, and
+// its callback runs once when the last byte has gone
+static void pcSerialComBulkOrderTest()
+{
+    static const pcSerialComChunk_t chunks[] = {
+        CHUNK( "first chunk\r\n" ),
+        CHUNK( "" ),
+        CHUNK( "second chunk\r\n" ),
+    };
+
+    bulkDoneCalls = 0;
+    pcSerialComSessionStringWrite( PC_SERIAL_COM_SESSION_USB, "before\r\n" );
+    HOST_TEST_CHECK( pcSerialComBulkWrite( PC_SERIAL_COM_SESSION_USB,
+                                           chunks, 3, &bulkDone ) );
+    pcSerialComSessionStringWrite( PC_SERIAL_COM_SESSION_USB, "after\r\n" );
+
+    HOST_TEST_CHECK( usb->hostTransmit( 21 ) ==
+                     "before\r\nfirst chunk\r\n" );
+    HOST_TEST_CHECK( bulkDoneCalls == 0 );
+    HOST_TEST_CHECK( usb->hostTransmit( TRANSMIT_ALL ) ==
+                     "second chunk\r\nafter\r\n" );
+    HOST_TEST_CHECK( bulkDoneCalls == 1 );
+    HOST_TEST_CHECK( !pcSerialComBulkBusyRead( PC_SERIAL_COM_SESSION_USB ) );
+
+    // Nothing went to the other session
+    HOST_TEST_CHECK( aux->hostTransmit( TRANSMIT_ALL ).empty() );
+}
+
+static void pcSerialComBulkBusyTest()
+{
+    static const pcSerialComChunk_t chunks[] = { CHUNK( "busy\r\n" ) };
+
+    HOST_TEST_CHECK( !pcSerialComBulkWrite( PC_SERIAL_COM_SESSION_USB,
+                                            chunks, 0, nullptr ) );
+    HOST_TEST_CHECK( pcSerialComBulkWrite( PC_SERIAL_COM_SESSION_USB,
+                                           chunks, 1, nullptr ) );
+    HOST_TEST_CHECK( !pcSerialComBulkWrite( PC_SERIAL_COM_SESSION_USB,
+                                            chunks, 1, nullptr ) );
+    HOST_TEST_CHECK( !pcSerialComIdleRead() );
+    HOST_TEST_CHECK( usb->hostTransmit( TRANSMIT_ALL ) == "busy\r\n" );
+    HOST_TEST_CHECK( pcSerialComIdleRead() );
+}
+
+// A notification raised in the middle of a text transfer goes out at the
+// next line end, between two of its lines
+static void pcSerialComNotificationSpliceTest()
+{
+    static const pcSerialComChunk_t chunks[] = {
+        CHUNK( "line one\r\n" ),
+        CHUNK( "line two\r\n" ),
+    };
+
+    HOST_TEST_CHECK( pcSerialComBulkWrite( PC_SERIAL_COM_SESSION_USB,
+                                           chunks, 2, nullptr ) );
+    HOST_TEST_CHECK( usb->hostTransmit( 4 ) == "line" );
+    pcSerialComNotificationWrite( "ALARM\r\n" );
+    HOST_TEST_CHECK( usb->hostTransmit( TRANSMIT_ALL ) ==
+                     " one\r\nALARM\r\nline two\r\n" );
+    HOST_TEST_CHECK( aux->hostTransmit( TRANSMIT_ALL ) == "ALARM\r\n" );
+}
+
+// Binary data has no lines: the notification waits for the whole transfer
+static void pcSerialComBinaryBulkTest()
+{
+    static const char data[] = { 'B', '\n', 0, 'C', '\n' };
+    static const pcSerialComChunk_t chunks[] = { { data, sizeof(data) } };
+    std::string transmitted;
+
+    HOST_TEST_CHECK( pcSerialComBulkBinaryWrite( PC_SERIAL_COM_SESSION_USB,
+                                                 chunks, 1, &bulkDone ) );
+    HOST_TEST_CHECK( usb->hostTransmit( 1 ) == "B" );
+    pcSerialComNotificationWrite( "ALARM\r\n" );
+    transmitted = usb->hostTransmit( TRANSMIT_ALL );
+    HOST_TEST_CHECK( transmitted == std::string( data + 1, 4 ) + "ALARM\r\n" );
+    aux->hostTransmit( TRANSMIT_ALL );
+}
+
+#endif
+
+// While a transfer is running, pcSerialComChunksWrite() users fall back to
+// the TX queue; the queued text follows the transfer
+static void pcSerialComBulkStringFallbackTest()
+{
+    static const pcSerialComChunk_t chunks[] = { CHUNK( "bulk\r\n" ) };
+
+    HOST_TEST_CHECK( pcSerialComBulkWrite( PC_SERIAL_COM_SESSION_AUX,
+                                           chunks, 1, nullptr ) );
+    HOST_TEST_CHECK( !pcSerialComBulkWrite( PC_SERIAL_COM_SESSION_AUX,
+                                            chunks, 1, nullptr ) );
+    pcSerialComSessionStringWrite( PC_SERIAL_COM_SESSION_AUX, "queued\r\n" );
+    HOST_TEST_CHECK( aux->hostTransmit( TRANSMIT_ALL ) == "bulk\r\nqueued\r\n" );
+    HOST_TEST_CHECK( usb->hostTransmit( TRANSMIT_ALL ).empty() );
+}
+
+// Frames that queue up before the superloop gets to them each keep the time
+// their own line end arrived
+static void pcSerialComPipelinedFramesTest()
+{
+    requests.clear();
+    hostReceiveAt( usb, "{\"id\":1}\r\n", 1000 );
+    hostReceiveAt( usb, "{\"id\":2}\n", 2000 );
+    hostReceiveAt( usb, "{\"id\":3}\r", 3000 );
+    monotonicTime_us = 9000;
+    pcSerialComUpdate();
+    HOST_TEST_CHECK( requests == "{\"id\":1}@1000 {\"id\":2}@2000 "
+                                 "{\"id\":3}@3000 " );
+    usb->hostTransmit( TRANSMIT_ALL );
+}
+
+// In standby the RX pins wake the panel instead of the UARTs, and what
+// arrived meanwhile is read as soon as the standby ends
+static void pcSerialComStandbyTest()
+{
+    InterruptIn* usbWakeUp = hostInterruptInFind( USBRX );
+    InterruptIn* auxWakeUp = hostInterruptInFind( PA_3 );
+
+    HOST_TEST_CHECK( usbWakeUp != nullptr && auxWakeUp != nullptr );
+    if ( usbWakeUp == nullptr || auxWakeUp == nullptr ) {
+        return;
+    }
+    wakeUps = 0;
+    usbWakeUp->hostFall();
+    HOST_TEST_CHECK( wakeUps == 0 );
+
+    requests.clear();
+    pcSerialComStandbyEnter();
+    usbWakeUp->hostFall();
+    auxWakeUp->hostFall();
+    HOST_TEST_CHECK( wakeUps == 2 );
+    hostReceiveAt( usb, "{\"id\":4}\r", 4000 );
+    HOST_TEST_CHECK( pcSerialComIdleRead() );
+
+    monotonicTime_us = 5000;
+    pcSerialComStandbyExit();
+    HOST_TEST_CHECK( !pcSerialComIdleRead() );
+    wakeUps = 0;
+    usbWakeUp->hostFall();
+    HOST_TEST_CHECK( wakeUps == 0 );
+    pcSerialComUpdate();
+    HOST_TEST_CHECK( requests == "{\"id\":4}@5000 " );
+    usb->hostTransmit( TRANSMIT_ALL );
+    HOST_TEST_CHECK( pcSerialComIdleRead() );
+}
+
+static void hostReceiveAt( SerialBase* serial, const char* str,
+                           uint64_t time_us )
+{
+    monotonicTime_us = time_us;
+    serial->hostReceive( (const uint8_t*)str, strlen( str ) );
+}
+
+static void bulkDone()
+{
+    bulkDoneCalls++;
+}
+
+#if SERIAL_TX_DMA_ENABLED
+// The menu goes out one DMA transfer per line, and the same as on the
+// interrupt-driven console
+static void pcSerialComDmaMenuTest()
+{
+    pcSerialComStats_t stats;
+    std::string menu;
+    int numberOfLines;
+
+    menu = usbTransmitAll();
+    numberOfLines = std::count( menu.begin(), menu.end(), '\n' );
+    HOST_TEST_CHECK( menu.compare( 0, 21, "Available commands:\r\n" ) == 0 );
+    HOST_TEST_CHECK( menu == aux->hostTransmit( TRANSMIT_ALL ) );
+    HOST_TEST_CHECK( dmaTransfers == numberOfLines );
+    HOST_TEST_CHECK( !pcSerialComBulkBusyRead( PC_SERIAL_COM_SESSION_USB ) );
+
+    pcSerialComStatsRead( PC_SERIAL_COM_SESSION_USB, &stats );
+    HOST_TEST_CHECK( stats.txBytes == menu.size() );
+    HOST_TEST_CHECK( pcSerialComIdleRead() );
+}
+
+// Text goes out a line at a time, so a notification raised mid-transfer
+// still goes in at the next line end; nothing else touches the UART while
+// a segment is out
+static void pcSerialComDmaSpliceTest()
+{
+    static const pcSerialComChunk_t chunks[] = {
+        CHUNK( "line one\r\nline two\r\n" ),
+        CHUNK( "" ),
+        CHUNK( "three\r\n" ),
+    };
+
+    bulkDoneCalls = 0;
+    HOST_TEST_CHECK( pcSerialComBulkWrite( PC_SERIAL_COM_SESSION_USB,
+                                           chunks, 3, &bulkDone ) );
+    HOST_TEST_CHECK( usb->hostTransmit( TRANSMIT_ALL ).empty() );
+    HOST_TEST_CHECK( dmaSegment == "line one\r\n" );
+
+    pcSerialComNotificationWrite( "ALARM\r\n" );
+    HOST_TEST_CHECK( usb->hostTransmit( TRANSMIT_ALL ).empty() );
+    HOST_TEST_CHECK( dmaSegmentComplete() == "line one\r\n" );
+    HOST_TEST_CHECK( usb->hostTransmit( TRANSMIT_ALL ) == "ALARM\r\n" );
+    HOST_TEST_CHECK( dmaSegmentComplete() == "line two\r\n" );
+    HOST_TEST_CHECK( usb->hostTransmit( TRANSMIT_ALL ).empty() );
+    HOST_TEST_CHECK( bulkDoneCalls == 0 );
+    HOST_TEST_CHECK( dmaSegmentComplete() == "three\r\n" );
+    HOST_TEST_CHECK( bulkDoneCalls == 1 );
+    HOST_TEST_CHECK( !dmaBusy );
+    HOST_TEST_CHECK( aux->hostTransmit( TRANSMIT_ALL ) == "ALARM\r\n" );
+    HOST_TEST_CHECK( pcSerialComIdleRead() );
+}
+
+// Binary data goes out whole, and the notification waits for it
+static void pcSerialComDmaBinaryTest()
+{
+    static const char data[] = { 'B', '\n', 0, 'C', '\n' };
+    static const pcSerialComChunk_t chunks[] = { { data, sizeof(data) } };
+
+    HOST_TEST_CHECK( pcSerialComBulkBinaryWrite( PC_SERIAL_COM_SESSION_USB,
+                                                 chunks, 1, nullptr ) );
+    usb->hostTransmit( TRANSMIT_ALL );
+    pcSerialComNotificationWrite( "ALARM\r\n" );
+    HOST_TEST_CHECK( usb->hostTransmit( TRANSMIT_ALL ).empty() );
+    HOST_TEST_CHECK( dmaSegmentComplete() == std::string( data, sizeof(data) ) );
+    HOST_TEST_CHECK( usbTransmitAll() == "ALARM\r\n" );
+    aux->hostTransmit( TRANSMIT_ALL );
+}
+
+// Ends the segment that is out, as the DMA interrupt would
+static std::string dmaSegmentComplete()
+{
+    std::lock_guard<std::recursive_mutex> lock( hostInterruptLock() );
+    std::string segment;
+
+    HOST_TEST_CHECK( dmaBusy );
+    segment.swap( dmaSegment );
+    dmaBusy = false;
+    dmaDoneCallback();
+    return segment;
+}
+
+// Runs the TX interrupt and the DMA until the USB console has sent
+// everything
+static std::string usbTransmitAll()
+{
+    std::string transmitted = usb->hostTransmit( TRANSMIT_ALL );
+    while ( dmaBusy ) {
+        transmitted += dmaSegmentComplete();
+        transmitted += usb->hostTransmit( TRANSMIT_ALL );
+    }
+    return transmitted;
+}
+#endif
+
+//=====[Stand-ins for the modules pc_serial_com calls]=========================
+
+#if SERIAL_TX_DMA_ENABLED
+void serialTxDmaInit( Callback<void()> onDone )
+{
+    dmaDoneCallback = onDone;
+}
+void serialTxDmaStart( const char* data, int length )
+{
+    HOST_TEST_CHECK( !dmaBusy );
+    dmaSegment.assign( data, length );
+    dmaBusy = true;
+    dmaTransfers++;
+}
+#endif
+
+bool sirenStateRead() { return false; }
+bool gasDetectorStateRead() { return false; }
+bool overTemperatureDetectorStateRead() { return false; }
+float temperatureSensorReadCelsius() { return 25.0f; }
+float temperatureSensorReadFahrenheit() { return 77.0f; }
+bool codeSequenceCheck( const char* codeSequenceToCheck )
+{
+    (void)codeSequenceToCheck;
+    return true;
+}
+bool parametersCodeWrite( const char* code )
+{
+    (void)code;
+    return true;
+}
+int userCodesFind( const char* code )
+{
+    (void)code;
+    return USER_CODES_NO_USER;
+}
+uint64_t dateAndTimeMonotonicRead() { return monotonicTime_us; }
+void dateAndTimeRead( char* str ) { str[0] = '\0'; }
+void dateAndTimeWrite( int year, int month, int day,
+                       int hour, int minute, int second )
+{
+    (void)year; (void)month; (void)day;
+    (void)hour; (void)minute; (void)second;
+}
+int eventLogNumberOfStoredEvents() { return 0; }
+void eventLogRead( int index, char* str )
+{
+    (void)index;
+    str[0] = '\0';
+}
+void powerManagerWakeUp()
+{
+    wakeUps++;
+}
+void powerManagerStatsRead( powerManagerStats_t* stats )
+{
+    memset( stats, 0, sizeof(*stats) );
+}
+// Records each request with the time it was received
+void serialProtocolRequestProcess( int sessionId, const char* request,
+                                   uint64_t received_us, char* response )
+{
+    (void)sessionId;
+    requests += std::string( request ) + "@" +
+                std::to_string( received_us ) + " ";
+    response[0] = '\0';
+}
+void serialProtocolErrorWrite( const char* error, char* response )
+{
+    (void)error;
+    response[0] = '\0';
+}
+void systemWatchdogResetReportRead( char* str ) { str[0] = '\0'; }
@@ -0,0 +1,95 @@
+//=====[Libraries]=============================================================
+
+#include "spsc_queue.h"
+
+#include <stdio.h>
+#include <chrono>
+
+//=====[Declaration of private defines]========================================
+
+#define BENCH_NUMBER_OF_PAIRS      50000000u
+#define BENCH_NUMBER_OF_PUSHES     4096u
+#define BENCH_NUMBER_OF_ROUNDS     10000u
+
+//=====[Declaration of private data types]=====================================
+
+typedef std::chrono::steady_clock benchClock_t;
+
+//=====[Declaration and initialization of private global variables]============
+
+// Everything popped is summed into here and printed, so the compiler cannot
+// drop the queue operations being timed
+static volatile unsigned int benchChecksum = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void spscQueuePairBench();
+static void spscQueuePushBench();
+static double benchElapsed_ns( benchClock_t::time_point start );
+
+//=====[Implementations of public functions]===================================
+
+// Not a test: prints what the queue costs on this host. Run "make bench".
+int main()
+{
+    spscQueuePairBench();
+    spscQueuePushBench();
+    printf( "spsc_queue_bench: checksum %u\n", benchChecksum );
+    return 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+// One push and one pop, the throughput of an uncontended handoff
+static void spscQueuePairBench()
+{
+    SpscQueue<unsigned int, 128> queue;
+    benchClock_t::time_point start;
+    unsigned int checksum = 0;
+    unsigned int item = 0;
+    unsigned int i;
+
+    start = benchClock_t::now();
+    for ( i = 0; i < BENCH_NUMBER_OF_PAIRS; i++ ) {
+        queue.push( i );
+        queue.pop( &item );
+        checksum += item;
+    }
+    printf( "spsc_queue_bench: push+pop %.2f ns\n",
+            benchElapsed_ns( start ) / BENCH_NUMBER_OF_PAIRS );
+    benchChecksum += checksum;
+}
+
+// A push alone, the cost an interrupt pays to hand over one item. Only the
+// pushes are timed; the queue is drained between rounds.
+static void spscQueuePushBench()
+{
+    static SpscQueue<unsigned int, BENCH_NUMBER_OF_PUSHES> queue;
+    benchClock_t::time_point start;
+    double pushTime_ns = 0;
+    unsigned int checksum = 0;
+    unsigned int item;
+    unsigned int round;
+    unsigned int i;
+
+    for ( round = 0; round < BENCH_NUMBER_OF_ROUNDS; round++ ) {
+        start = benchClock_t::now();
+        for ( i = 0; i < BENCH_NUMBER_OF_PUSHES; i++ ) {
+            queue.push( i );
+        }
+        pushTime_ns += benchElapsed_ns( start );
+        while ( queue.pop( &item ) ) {
+            checksum += item;
+        }
+    }
+    printf( "spsc_queue_bench: push %.2f ns\n",
+            pushTime_ns / ( (double)BENCH_NUMBER_OF_ROUNDS *
+                            BENCH_NUMBER_OF_PUSHES ) );
+    benchChecksum += checksum;
+}
+
+static double benchElapsed_ns( benchClock_t::time_point start )
+{
+    return std::chrono::duration<double, std::nano>(
+        benchClock_t::now() - start ).count();
+}
@@ -0,0 +1,137 @@
+//=====[Libraries]=============================================================
+
+#include "host_test.h"
+
+#include "spsc_queue.h"
+
+#include <thread>
+
+//=====[Declaration of private defines]========================================
+
+#define STRESS_NUMBER_OF_ITEMS    2000000u
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void spscQueueEmptyTest();
+static void spscQueueFullTest();
+static void spscQueueWrapTest();
+static void spscQueueStressTest();
+
+//=====[Implementations of public functions]===================================
+
+int main()
+{
+    spscQueueEmptyTest();
+    spscQueueFullTest();
+    spscQueueWrapTest();
+    spscQueueStressTest();
+    return hostTestResult( "spsc_queue_test" );
+}
+
+//=====[Implementations of private functions]==================================
+
+static void spscQueueEmptyTest()
+{
+    SpscQueue<int, 4> queue;
+    int item = 7;
+
+    HOST_TEST_CHECK( queue.empty() );
+    HOST_TEST_CHECK( queue.size() == 0 );
+    HOST_TEST_CHECK( queue.space() == 4 );
+    HOST_TEST_CHECK( !queue.pop( &item ) );
+    HOST_TEST_CHECK( !queue.peek( &item ) );
+    HOST_TEST_CHECK( item == 7 );
+
+    HOST_TEST_CHECK( queue.push( 1 ) );
+    HOST_TEST_CHECK( queue.pop( &item ) && item == 1 );
+    HOST_TEST_CHECK( queue.empty() );
+    HOST_TEST_CHECK( !queue.pop( &item ) );
+}
+
+// Every slot is usable: Capacity pushes succeed, the next one does not
+static void spscQueueFullTest()
+{
+    SpscQueue<int, 8> queue;
+    int item;
+    int i;
+
+    HOST_TEST_CHECK( queue.capacity() == 8 );
+    for ( i = 0; i < 8; i++ ) {
+        HOST_TEST_CHECK( queue.push( i ) );
+    }
+    HOST_TEST_CHECK( queue.size() == 8 );
+    HOST_TEST_CHECK( queue.space() == 0 );
+    HOST_TEST_CHECK( !queue.push( 8 ) );
+    HOST_TEST_CHECK( queue.writeCount() == 8 );
+
+    // A refused push leaves the queue as it was
+    HOST_TEST_CHECK( queue.peek( &item ) && item == 0 );
+    HOST_TEST_CHECK( queue.pop( &item ) && item == 0 );
+    HOST_TEST_CHECK( queue.push( 8 ) );
+    for ( i = 1; i <= 8; i++ ) {
+        HOST_TEST_CHECK( queue.pop( &item ) && item == i );
+    }
+    HOST_TEST_CHECK( queue.empty() );
+}
+
+// The indices run past the end of the array many times over
+static void spscQueueWrapTest()
+{
+    SpscQueue<unsigned int, 4> queue;
+    unsigned int next = 0;
+    unsigned int expected = 0;
+    unsigned int item;
+    int round;
+
+    for ( round = 0; round < 1000; round++ ) {
+        while ( queue.push( next ) ) {
+            next++;
+        }
+        HOST_TEST_CHECK( queue.size() == 4 );
+        // Leave a different number behind each round
+        while ( queue.size() > (unsigned int)( round % 4 ) ) {
+            HOST_TEST_CHECK( queue.pop( &item ) && item == expected );
+            expected++;
+        }
+    }
+    HOST_TEST_CHECK( queue.writeCount() == next );
+    HOST_TEST_CHECK( queue.readCount() == expected );
+    HOST_TEST_CHECK( queue.writeCount() - queue.readCount() == queue.size() );
+}
+
+// One producer and one consumer thread: every item arrives once, in order.
+// Both yield when they cannot go on, so the test also runs on a single core.
+static void spscQueueStressTest()
+{
+    static SpscQueue<unsigned int, 16> queue;
+    unsigned int outOfOrder = 0;
+    unsigned int received = 0;
+
+    std::thread producer( []() {
+        unsigned int i = 0;
+        while ( i < STRESS_NUMBER_OF_ITEMS ) {
+            if ( queue.push( i ) ) {
+                i++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    } );
+
+    while ( received < STRESS_NUMBER_OF_ITEMS ) {
+        unsigned int item;
+        if ( queue.pop( &item ) ) {
+            if ( item != received ) {
+                outOfOrder++;
+            }
+            received++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    HOST_TEST_CHECK( outOfOrder == 0 );
+    HOST_TEST_CHECK( queue.empty() );
+    HOST_TEST_CHECK( queue.readCount() == STRESS_NUMBER_OF_ITEMS );
+}
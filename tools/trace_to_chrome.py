@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""Converts a trace buffer dump to Chrome trace JSON.
+
+Build the firmware with TRACE_BUFFER_ENABLED set to 1, capture the raw
+console output while pressing 'x', then run
+
+    trace_to_chrome.py capture.bin trace.json
+
+and open trace.json in chrome://tracing or https://ui.perfetto.dev.
+Text around the dump in the capture is skipped.
+"""
+
+import json
+import struct
+import sys
+
+MAGIC = b"TRC1"
+HEADER = struct.Struct("<5I")
+RECORD = struct.Struct("<3I")
+
+# Keep in step with traceBufferEvent_t in modules/trace_buffer/trace_buffer.h
+EVENT_NAMES = [
+    "TIME_SYNC",
+    "TASK_BEGIN",
+    "TASK_END",
+    "STANDBY_BEGIN",
+    "STANDBY_END",
+    "KEYPAD_SCAN_BEGIN",
+    "KEYPAD_SCAN_END",
+    "KEYPAD_KEY",
+    "SERIAL_COMMAND",
+    "SERIAL_FLOW_BEGIN",
+    "SERIAL_FLOW_END",
+    "OUTPUT_CHANGE",
+]
+
+TASK_NAMES = ["userInterface", "fireAlarm", "pcSerialCom", "eventLog",
+              "userCodes"]
+SESSION_NAMES = ["usb", "aux"]
+OUTPUT_NAMES = ["siren", "strobeLight", "incorrectCodeLed", "systemBlockedLed"]
+
+# Threads in the viewer
+TID_SUPERLOOP = 1
+TID_KEYPAD = 2
+TID_SERIAL = 3
+TID_OUTPUTS = 4
+
+
+def name_of(names, index):
+    if index < len(names):
+        return names[index]
+    return str(index)
+
+
+def read_dump(data):
+    start = data.find(MAGIC)
+    if start < 0:
+        sys.exit("no trace buffer dump found")
+    (_, record_size, number_of_records, cycles_per_second,
+     dropped_records) = HEADER.unpack_from(data, start)
+    if record_size != RECORD.size:
+        sys.exit("unexpected record size %d" % record_size)
+    offset = start + HEADER.size
+    if len(data) < offset + number_of_records * record_size:
+        sys.exit("the dump is truncated")
+    records = [RECORD.unpack_from(data, offset + i * record_size)
+               for i in range(number_of_records)]
+    return records, cycles_per_second, dropped_records
+
+
+def timestamps(records, cycles_per_second):
+    """Microseconds for each record.
+
+    The cycle counter wraps every few seconds and stops while the core
+    sleeps, so each record is placed relative to the nearest preceding
+    TIME_SYNC record, which holds the monotonic time (low 32 bits).
+    """
+    anchors = [i for i, record in enumerate(records) if record[1] == 0]
+    if not anchors:
+        sys.exit("the dump holds no TIME_SYNC record")
+
+    times = [0.0] * len(records)
+    anchor_us = 0
+    previous_low_us = records[anchors[0]][2]
+    anchor_cycles = records[anchors[0]][0]
+    for i, (cycles, event, argument) in enumerate(records):
+        if event == 0:
+            anchor_us += (argument - previous_low_us) & 0xFFFFFFFF
+            previous_low_us = argument
+            anchor_cycles = cycles
+        delta = (cycles - anchor_cycles) & 0xFFFFFFFF
+        # Records before the first anchor are slightly earlier than it
+        if i < anchors[0]:
+            delta = -((anchor_cycles - cycles) & 0xFFFFFFFF)
+        times[i] = anchor_us + delta * 1e6 / cycles_per_second
+    return times
+
+
+def convert(records, cycles_per_second, dropped_records):
+    events = []
+    times = timestamps(records, cycles_per_second)
+
+    def add(name, phase, ts, tid, args=None):
+        event = {"name": name, "ph": phase, "ts": ts, "pid": 1, "tid": tid}
+        if phase == "i":
+            event["s"] = "t"
+        if args:
+            event["args"] = args
+        events.append(event)
+
+    for ts, (_, event, argument) in zip(times, records):
+        name = name_of(EVENT_NAMES, event)
+        if name == "TIME_SYNC":
+            continue
+        elif name == "TASK_BEGIN":
+            add(name_of(TASK_NAMES, argument), "B", ts, TID_SUPERLOOP)
+        elif name == "TASK_END":
+            add(name_of(TASK_NAMES, argument), "E", ts, TID_SUPERLOOP)
+        elif name == "STANDBY_BEGIN":
+            add("standby", "B", ts, TID_SUPERLOOP)
+        elif name == "STANDBY_END":
+            add("standby", "E", ts, TID_SUPERLOOP,
+                {"wokenByEvent": bool(argument)})
+        elif name == "KEYPAD_SCAN_BEGIN":
+            add("scanning", "B", ts, TID_KEYPAD)
+        elif name == "KEYPAD_SCAN_END":
+            add("scanning", "E", ts, TID_KEYPAD)
+        elif name == "KEYPAD_KEY":
+            add("key", "i", ts, TID_KEYPAD,
+                {"key": chr(argument >> 8),
+                 "pressed": bool(argument & 1)})
+        elif name == "SERIAL_COMMAND":
+            add("command", "i", ts, TID_SERIAL,
+                {"session": name_of(SESSION_NAMES, argument >> 8),
+                 "key": chr(argument & 0xFF)})
+        elif name == "SERIAL_FLOW_BEGIN":
+            add("flow " + name_of(SESSION_NAMES, argument), "B", ts,
+                TID_SERIAL)
+        elif name == "SERIAL_FLOW_END":
+            add("flow " + name_of(SESSION_NAMES, argument), "E", ts,
+                TID_SERIAL)
+        elif name == "OUTPUT_CHANGE":
+            add(name_of(OUTPUT_NAMES, argument >> 1), "C", ts, TID_OUTPUTS,
+                {"level": argument & 1})
+        else:
+            add(name, "i", ts, TID_SUPERLOOP, {"argument": argument})
+
+    thread_names = {TID_SUPERLOOP: "superloop", TID_KEYPAD: "matrixKeypad",
+                    TID_SERIAL: "pcSerialCom", TID_OUTPUTS: "outputs"}
+    for tid, thread_name in thread_names.items():
+        events.append({"name": "thread_name", "ph": "M", "pid": 1,
+                       "tid": tid, "args": {"name": thread_name}})
+
+    return {"traceEvents": events,
+            "otherData": {"droppedRecords": dropped_records,
+                          "cyclesPerSecond": cycles_per_second}}
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit("usage: trace_to_chrome.py <capture> <output.json>")
+    with open(sys.argv[1], "rb") as capture:
+        records, cycles_per_second, dropped_records = read_dump(capture.read())
+    trace = convert(records, cycles_per_second, dropped_records)
+    with open(sys.argv[2], "w") as output:
+        json.dump(trace, output, indent=1)
+    print("%d records, %d dropped before them" %
+          (len(records), dropped_records))
+
+
+if __name__ == "__main__":
+    main()